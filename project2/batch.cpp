@@ -0,0 +1,85 @@
+#include "batch.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief Function which finds the machine a configuration simulates. Every FU
+ *        holds its instruction until the result gets a result bus, so no more
+ *        results than FUs ever wait for one, and the result buses beyond the
+ *        number of FUs stay idle. Sweeps use FUs with a latency and an
+ *        initiation interval of one cycle, which hold one instruction each.
+ *
+ * @param config  Configuration of the sweep.
+ *
+ * @return  configuration with the same cycles, with no more result buses than FUs.
+ */
+sweep_config_t
+machine_configuration(
+  const sweep_config_t& config
+)
+{
+  sweep_config_t machine = config;
+  machine.r = std::min(config.r, config.k[0] + config.k[1] + config.k[2]);
+  return machine;
+}
+
+/**
+ * @brief Constructor for the batch.
+ *
+ * @param configs   Configurations to be simulated.
+ * @param trace     Trace shared by all the configurations.
+ */
+BatchSimulator::BatchSimulator(
+  const std::vector<sweep_config_t>& configs,
+  const TraceBuffer& trace
+) : m_machines(),
+  m_machineOf(),
+  m_trace(trace)
+{
+  for (std::vector<sweep_config_t>::const_iterator c = configs.begin(); c != configs.end(); ++c) {
+    sweep_config_t machine = machine_configuration(*c);
+    size_t m = 0;
+    while ((m < m_machines.size()) && (memcmp(&m_machines[m], &machine, sizeof(sweep_config_t)) != 0)) {
+      ++m;
+    }
+    if (m == m_machines.size()) {
+      m_machines.push_back(machine);
+    }
+    m_machineOf.push_back(m);
+  }
+}
+
+/**
+ * @brief Function which simulates all the configurations of the batch.
+ *
+ * @param stats         Vector in which the statistics of every configuration are returned.
+ * @param convergence   Settings for stopping every machine once its IPC has
+ *                      converged, or NULL to simulate the whole trace.
+ * @param p_results     Pointer to the vector in which the estimates of every
+ *                      configuration are returned, when stopping early.
+ */
+void
+BatchSimulator::simulate(
+  std::vector<proc_stats_t>& stats,
+  const convergence_params_t* const convergence,
+  std::vector<convergence_t>* const p_results
+)
+{
+  std::vector<proc_stats_t> machineStats(m_machines.size());
+  std::vector<convergence_t> machineEstimates(m_machines.size());
+  for (size_t m = 0; m < m_machines.size(); ++m) {
+    simulate_configuration(m_machines[m], m_trace, &machineStats[m], convergence, &machineEstimates[m]);
+  }
+
+  stats.clear();
+  for (std::vector<size_t>::const_iterator m = m_machineOf.begin(); m != m_machineOf.end(); ++m) {
+    stats.push_back(machineStats[*m]);
+  }
+  if ((p_results != NULL) && (convergence != NULL)) {
+    p_results->clear();
+    for (std::vector<size_t>::const_iterator m = m_machineOf.begin(); m != m_machineOf.end(); ++m) {
+      p_results->push_back(machineEstimates[*m]);
+    }
+  }
+}
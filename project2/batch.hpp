@@ -0,0 +1,32 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "sweep.hpp"
+
+#include <vector>
+
+sweep_config_t machine_configuration(const sweep_config_t&);
+
+/**
+ * @brief Simulator for a batch of configurations of one trace, which simulates
+ *        every distinct machine of the batch once and gives its results to all
+ *        the configurations describing it. Configurations which only differ in
+ *        result buses that can never be used are the same machine, cycle for cycle.
+ */
+class BatchSimulator {
+public:
+  BatchSimulator(const std::vector<sweep_config_t>&, const TraceBuffer&);
+
+  size_t machines() const { return m_machines.size(); }
+
+  void simulate(std::vector<proc_stats_t>&, const convergence_params_t* const = NULL, std::vector<convergence_t>* const = NULL);
+
+private:
+  // distinct machines of the batch, and the machine of every configuration
+  std::vector<sweep_config_t> m_machines;
+  std::vector<size_t> m_machineOf;
+
+  const TraceBuffer& m_trace;
+};
+
+#endif /* BATCH_HPP */
@@ -0,0 +1,42 @@
+import json
+import sys
+
+def load(fileName):
+  with open(fileName) as f:
+    results = json.load(f)['results']
+  return dict(((r['trace'], r['config']), r) for r in results)
+
+def main():
+  if len(sys.argv) < 3:
+    print('Usage: %s baseline.json current.json [threshold]' % sys.argv[0])
+    return 2
+  baseline = load(sys.argv[1])
+  current = load(sys.argv[2])
+  threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 0.05
+
+  regressions = 0
+  print('TRACE\tCONFIG\tBASELINE INST/S\tCURRENT INST/S\tCHANGE')
+  for key in sorted(current):
+    if key not in baseline:
+      continue
+    old = baseline[key]
+    new = current[key]
+    change = (new['inst_per_sec'] / old['inst_per_sec'] - 1.0) if old['inst_per_sec'] > 0 else 0.0
+    flags = []
+    if change < -threshold:
+      flags.append('SLOWER')
+    if old.get('sim_memory_kb', 0) > 0 and float(new['sim_memory_kb']) / old['sim_memory_kb'] - 1.0 > threshold:
+      flags.append('MORE MEMORY')
+    if new['cycles'] != old['cycles']:
+      flags.append('DIFFERENT CYCLES')
+    regressions += 1 if flags else 0
+    print('%s\t%s\t%.0f\t%.0f\t%+.1f%%\t%s' % (key[0], key[1], old['inst_per_sec'], new['inst_per_sec'], 100.0 * change, ' '.join(flags)))
+
+  if regressions > 0:
+    print('%d regressions above %.0f%%' % (regressions, 100.0 * threshold))
+    return 1
+  print('No regressions above %.0f%%' % (100.0 * threshold))
+  return 0
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,178 @@
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "processor.hpp"
+#include "sweep.hpp"
+#include "trace_gen.hpp"
+
+#define DEFAULT_SYNTHETIC_SIZE 1000000
+#define DEFAULT_REPETITIONS 3
+
+/* Fixed configurations measured for every trace */
+static const sweep_config_t benchConfigs[] = {
+    {1, 4, {1, 1, 1}},
+    {8, 4, {1, 2, 3}},
+    {4, 8, {2, 2, 2}},
+    {16, 8, {8, 8, 8}},
+    {32, 16, {32, 32, 32}}
+};
+
+/* Bundled traces, measured if they are present */
+static const char* bundledTraces[] = {"gcc", "gobmk", "hmmer", "mcf"};
+
+typedef struct _bench_trace_t {
+    std::string name;
+    TraceBuffer buffer;
+    std::vector<trace_record_t> records;
+    const trace_record_t* begin;
+    const trace_record_t* end;
+} bench_trace_t;
+
+void print_help_and_exit(void) {
+    printf("procsim_bench [OPTIONS] [traces/file.trace ...]\n");
+    printf("  -o file.json\tFile to write the results to (default: bench.json)\n");
+    printf("  -n N\t\tInstructions in every synthetic trace, 0 for none (default: %d)\n", DEFAULT_SYNTHETIC_SIZE);
+    printf("  -s N\t\tRepetitions of every run, the fastest is reported (default: %d)\n", DEFAULT_REPETITIONS);
+    printf("  -h\t\tThis helpful output\n");
+    printf("Without traces, the bundled traces in traces/ are used if they exist\n");
+    exit(0);
+}
+
+//
+// synthesize_trace
+//
+//  fills the records with a reproducible synthetic trace
+//
+void synthesize_trace(std::vector<trace_record_t>& records, uint64_t size, double meanDistance, uint64_t seed) {
+    trace_gen_params_t params = TraceGenerator::defaultParams();
+    params.seed = seed;
+    params.mean_distance = meanDistance;
+    TraceGenerator generator(params);
+    records.resize(size);
+    for (uint64_t i = 0; i < size; ++i) {
+        generator.next(&records[i]);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    const char* outName = "bench.json";
+    uint64_t syntheticSize = DEFAULT_SYNTHETIC_SIZE;
+    unsigned repetitions = DEFAULT_REPETITIONS;
+
+    while(-1 != (opt = getopt(argc, argv, "o:n:s:h"))) {
+        switch(opt) {
+        case 'o':
+            outName = optarg;
+            break;
+        case 'n':
+            syntheticSize = strtoull(optarg, NULL, 10);
+            break;
+        case 's':
+            repetitions = atoi(optarg);
+            break;
+        case 'h':
+            /* Fall through */
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+    if (repetitions == 0) {
+        print_help_and_exit();
+    }
+
+    std::vector<std::string> traceFiles(argv + optind, argv + argc);
+    if (traceFiles.empty()) {
+        for (int i = 0; i < 4; ++i) {
+            std::string name = std::string("traces/") + bundledTraces[i] + ".100k.trace";
+            if (access(name.c_str(), R_OK) == 0) {
+                traceFiles.push_back(name);
+            }
+        }
+    }
+
+    std::vector<bench_trace_t> traces(traceFiles.size() + ((syntheticSize > 0) ? 2 : 0));
+    for (size_t t = 0; t < traceFiles.size(); ++t) {
+        if (!traces[t].buffer.load(traceFiles[t].c_str())) {
+            fprintf(stderr, "Failed to load trace %s\n", traceFiles[t].c_str());
+            return 1;
+        }
+        traces[t].name = traceFiles[t];
+        traces[t].begin = traces[t].buffer.begin();
+        traces[t].end = traces[t].buffer.end();
+    }
+    if (syntheticSize > 0) {
+        /* Lots of independent instructions, and mostly dependent chains */
+        bench_trace_t& ilp = traces[traceFiles.size()];
+        synthesize_trace(ilp.records, syntheticSize, 32.0, 1);
+        ilp.name = "synthetic-ilp";
+        bench_trace_t& chains = traces[traceFiles.size() + 1];
+        synthesize_trace(chains.records, syntheticSize, 1.5, 2);
+        chains.name = "synthetic-chains";
+        for (int s = 0; s < 2; ++s) {
+            bench_trace_t& synthetic = traces[traceFiles.size() + s];
+            synthetic.begin = &synthetic.records[0];
+            synthetic.end = synthetic.begin + synthetic.records.size();
+        }
+    }
+    if (traces.empty()) {
+        fprintf(stderr, "No traces to measure\n");
+        return 1;
+    }
+
+    FILE* out = fopen(outName, "w");
+    if (out == NULL) {
+        fprintf(stderr, "Failed to open %s for writing\n", outName);
+        return 1;
+    }
+    fprintf(out, "{\n  \"results\": [");
+
+    printf("TRACE\tCONFIG\tINST/S\tNS/CYCLE\tSIM MEMORY (KB)\n");
+    const size_t numConfigs = sizeof(benchConfigs) / sizeof(sweep_config_t);
+    bool first = true;
+    for (size_t t = 0; t < traces.size(); ++t) {
+        for (size_t c = 0; c < numConfigs; ++c) {
+            const sweep_config_t& config = benchConfigs[c];
+            double best = 0.0;
+            proc_stats_t stats;
+            /* Memory held by the simulator itself, leaving out the trace */
+            size_t memory = 0;
+            for (unsigned rep = 0; rep < repetitions; ++rep) {
+                Processor processor(config.r, config.k, config.f);
+                processor.setTrace(traces[t].begin, traces[t].end);
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                processor.run();
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                stats = processor.statistics();
+                memory = processor.allocatedBytes();
+                if (rep == 0 || elapsed.count() < best) {
+                    best = elapsed.count();
+                }
+            }
+
+            char configName[64];
+            snprintf(configName, sizeof(configName), "r%" PRIu64 "-f%" PRIu64 "-k%" PRIu64 ",%" PRIu64 ",%" PRIu64,
+                     config.r, config.f, config.k[0], config.k[1], config.k[2]);
+            double instPerSecond = (best > 0.0) ? (stats.retired_instruction / best) : 0.0;
+            double nsPerCycle = (stats.cycle_count > 0) ? (best * 1e9 / stats.cycle_count) : 0.0;
+            double memoryKB = memory / 1024.0;
+            printf("%s\t%s\t%.0f\t%.2f\t%.1f\n", traces[t].name.c_str(), configName, instPerSecond, nsPerCycle, memoryKB);
+
+            fprintf(out, "%s\n    {\"trace\": \"%s\", \"config\": \"%s\", ", first ? "" : ",", traces[t].name.c_str(), configName);
+            fprintf(out, "\"instructions\": %lu, \"cycles\": %lu, \"seconds\": %f, ", stats.retired_instruction, stats.cycle_count, best);
+            fprintf(out, "\"inst_per_sec\": %f, \"ns_per_cycle\": %f, \"sim_memory_kb\": %f}", instPerSecond, nsPerCycle, memoryKB);
+            first = false;
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Failed to write %s\n", outName);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,551 @@
+#include "block_trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+// shortest match worth encoding, and the farthest one which can be referenced
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 14
+
+/**
+ * @brief Function which reorders the bytes of the records of a block so that
+ *        the same byte of every record is stored together, after replacing the
+ *        instruction addresses by their differences. Registers, op codes and
+ *        most address differences are small, so this leaves long runs of
+ *        repeated bytes for the compressor.
+ *
+ * @param records   Records of the block.
+ * @param count     Number of records.
+ * @param planes    Buffer for the reordered bytes.
+ */
+static void
+split_planes(
+  const trace_record_t* const records,
+  const size_t count,
+  std::vector<uint8_t>& planes
+)
+{
+  planes.resize(count * sizeof(trace_record_t));
+  uint32_t previous = 0;
+  for (size_t i = 0; i < count; ++i) {
+    trace_record_t record = records[i];
+    uint32_t address = record.instruction_address;
+    record.instruction_address -= previous;
+    previous = address;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    for (size_t b = 0; b < sizeof(trace_record_t); ++b) {
+      planes[(b * count) + i] = bytes[b];
+    }
+  }
+}
+
+/**
+ * @brief Function which undoes split_planes().
+ *
+ * @param planes    Reordered bytes of the block.
+ * @param count     Number of records.
+ * @param records   Buffer for the records of the block.
+ */
+static void
+join_planes(
+  const std::vector<uint8_t>& planes,
+  const size_t count,
+  trace_record_t* const records
+)
+{
+  uint32_t previous = 0;
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&records[i]);
+    for (size_t b = 0; b < sizeof(trace_record_t); ++b) {
+      bytes[b] = planes[(b * count) + i];
+    }
+    records[i].instruction_address += previous;
+    previous = records[i].instruction_address;
+  }
+}
+
+static void
+lz_put_length(
+  std::vector<uint8_t>& out,
+  size_t length
+)
+{
+  for (; length >= 255; length -= 255) {
+    out.push_back(255);
+  }
+  out.push_back(static_cast<uint8_t>(length));
+}
+
+/**
+ * @brief Function which appends one sequence of the compressed stream: a
+ *        token with the lengths of the literals and of the match, the
+ *        literals, and the offset of the match unless it is the last sequence.
+ */
+static void
+lz_put_sequence(
+  std::vector<uint8_t>& out,
+  const uint8_t* const literals,
+  const size_t literalLength,
+  const size_t offset,
+  const size_t matchLength
+)
+{
+  size_t extraMatch = (matchLength > 0) ? (matchLength - LZ_MIN_MATCH) : 0;
+  out.push_back(static_cast<uint8_t>((std::min(literalLength, static_cast<size_t>(15)) << 4) |
+                                     std::min(extraMatch, static_cast<size_t>(15))));
+  if (literalLength >= 15) {
+    lz_put_length(out, literalLength - 15);
+  }
+  out.insert(out.end(), literals, literals + literalLength);
+  if (matchLength == 0) {
+    return;
+  }
+  out.push_back(static_cast<uint8_t>(offset & 0xff));
+  out.push_back(static_cast<uint8_t>(offset >> 8));
+  if (extraMatch >= 15) {
+    lz_put_length(out, extraMatch - 15);
+  }
+}
+
+/**
+ * @brief Function which compresses a buffer with a small LZ77 compressor in the
+ *        style of LZ4, finding matches through a hash of the next 4 bytes.
+ *
+ * @param in      Bytes to be compressed.
+ * @param size    Number of bytes.
+ * @param out     Buffer for the compressed bytes.
+ */
+static void
+lz_compress(
+  const uint8_t* const in,
+  const size_t size,
+  std::vector<uint8_t>& out
+)
+{
+  out.clear();
+  std::vector<int64_t> table(1 << LZ_HASH_BITS, -1);
+  size_t anchor = 0;
+  size_t i = 0;
+  while (i + LZ_MIN_MATCH <= size) {
+    uint32_t value;
+    memcpy(&value, in + i, sizeof(value));
+    uint32_t hash = (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+    int64_t candidate = table[hash];
+    table[hash] = static_cast<int64_t>(i);
+    if ((candidate < 0) || ((i - candidate) > LZ_MAX_OFFSET) || (memcmp(in + candidate, in + i, LZ_MIN_MATCH) != 0)) {
+      ++i;
+      continue;
+    }
+    size_t length = LZ_MIN_MATCH;
+    while ((i + length < size) && (in[candidate + length] == in[i + length])) {
+      ++length;
+    }
+    lz_put_sequence(out, in + anchor, i - anchor, i - candidate, length);
+    i += length;
+    anchor = i;
+  }
+  lz_put_sequence(out, in + anchor, size - anchor, 0, 0);
+}
+
+static bool
+lz_get_length(
+  const uint8_t*& in,
+  const uint8_t* const end,
+  size_t& length
+)
+{
+  uint8_t byte;
+  do {
+    if (in == end) {
+      return false;
+    }
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * @brief Function which decompresses the output of lz_compress().
+ *
+ * @param in      Compressed bytes.
+ * @param size    Number of compressed bytes.
+ * @param out     Buffer for the decompressed bytes, sized for all of them.
+ *
+ * @return  true if the stream was valid and filled the buffer exactly.
+ */
+static bool
+lz_decompress(
+  const uint8_t* in,
+  const size_t size,
+  std::vector<uint8_t>& out
+)
+{
+  const uint8_t* const end = in + size;
+  size_t o = 0;
+  while (in < end) {
+    uint8_t token = *in++;
+    size_t literalLength = token >> 4;
+    if ((literalLength == 15) && !lz_get_length(in, end, literalLength)) {
+      return false;
+    }
+    if ((literalLength > static_cast<size_t>(end - in)) || (literalLength > (out.size() - o))) {
+      return false;
+    }
+    memcpy(&out[o], in, literalLength);
+    in += literalLength;
+    o += literalLength;
+    if (in == end) {
+      break;
+    }
+
+    if ((end - in) < 2) {
+      return false;
+    }
+    size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+    in += 2;
+    size_t matchLength = token & 0xf;
+    if ((matchLength == 15) && !lz_get_length(in, end, matchLength)) {
+      return false;
+    }
+    matchLength += LZ_MIN_MATCH;
+    if ((offset == 0) || (offset > o) || (matchLength > (out.size() - o))) {
+      return false;
+    }
+    // matches may overlap the bytes they produce, so they are copied one byte at a time
+    for (size_t m = 0; m < matchLength; ++m, ++o) {
+      out[o] = out[o - offset];
+    }
+  }
+  return (o == out.size());
+}
+
+/**
+ * @brief Default constructor, creates a writer without a file.
+ */
+BlockTraceWriter::BlockTraceWriter(
+) : m_file(NULL),
+  m_blockRecords(DEFAULT_BLOCK_RECORDS),
+  m_instructionCount(0),
+  m_offset(0),
+  m_block(),
+  m_index()
+{
+}
+
+/**
+ * @brief Destructor, closes the file if it is still open.
+ */
+BlockTraceWriter::~BlockTraceWriter(
+)
+{
+  if (m_file != NULL) {
+    close();
+  }
+}
+
+/**
+ * @brief Function which creates a block compressed trace file.
+ *
+ * @param fileName      Name of the trace file.
+ * @param blockRecords  Number of instructions in a block.
+ *
+ * @return  true if the file was created.
+ */
+bool
+BlockTraceWriter::open(
+  const char* const fileName,
+  const uint32_t blockRecords
+)
+{
+  if (blockRecords == 0) {
+    return false;
+  }
+  m_file = fopen(fileName, "wb");
+  if (m_file == NULL) {
+    return false;
+  }
+  m_blockRecords = blockRecords;
+  m_instructionCount = 0;
+  m_block.clear();
+  m_index.clear();
+
+  // the header is written again at the end, once the counts and the index are known
+  block_trace_header_t header;
+  memset(&header, 0, sizeof(block_trace_header_t));
+  m_offset = sizeof(block_trace_header_t);
+  return (fwrite(&header, sizeof(block_trace_header_t), 1, m_file) == 1);
+}
+
+/**
+ * @brief Function which adds one instruction to the trace.
+ *
+ * @param record  Instruction to be added.
+ *
+ * @return  true if the instruction, and its block if that was completed, were written.
+ */
+bool
+BlockTraceWriter::append(
+  const trace_record_t& record
+)
+{
+  m_block.push_back(record);
+  ++m_instructionCount;
+  return (m_block.size() < m_blockRecords) || flush();
+}
+
+/**
+ * @brief Function which compresses and writes the buffered block.
+ */
+bool
+BlockTraceWriter::flush(
+)
+{
+  if (m_block.empty()) {
+    return true;
+  }
+  std::vector<uint8_t> planes;
+  std::vector<uint8_t> compressed;
+  split_planes(m_block.data(), m_block.size(), planes);
+  lz_compress(planes.data(), planes.size(), compressed);
+
+  block_trace_index_t entry = {m_offset, static_cast<uint32_t>(compressed.size()), static_cast<uint32_t>(m_block.size())};
+  m_index.push_back(entry);
+  m_offset += compressed.size();
+  m_block.clear();
+  return (fwrite(compressed.data(), 1, compressed.size(), m_file) == compressed.size());
+}
+
+/**
+ * @brief Function which writes the last block, the index and the header, and closes the file.
+ *
+ * @return  true if everything was written.
+ */
+bool
+BlockTraceWriter::close(
+)
+{
+  bool written = flush() &&
+                 (fwrite(m_index.data(), sizeof(block_trace_index_t), m_index.size(), m_file) == m_index.size());
+
+  block_trace_header_t header;
+  memset(&header, 0, sizeof(block_trace_header_t));
+  memcpy(header.magic, BLOCK_TRACE_MAGIC, TRACE_MAGIC_SIZE);
+  header.version = BLOCK_TRACE_VERSION;
+  header.block_records = m_blockRecords;
+  header.instruction_count = m_instructionCount;
+  header.block_count = m_index.size();
+  header.index_offset = m_offset;
+  rewind(m_file);
+  written = written && (fwrite(&header, sizeof(block_trace_header_t), 1, m_file) == 1);
+
+  written = (fclose(m_file) == 0) && written;
+  m_file = NULL;
+  return written;
+}
+
+/**
+ * @brief Default constructor, creates an empty trace.
+ */
+BlockTrace::BlockTrace(
+) : m_mapping(NULL),
+  m_mappingSize(0),
+  m_blockRecords(0),
+  m_instructionCount(0),
+  m_index()
+{
+}
+
+/**
+ * @brief Destructor, unmaps the trace file if one is mapped.
+ */
+BlockTrace::~BlockTrace(
+)
+{
+  close();
+}
+
+/**
+ * @brief Function which maps a block compressed trace file in memory and
+ *        checks its index.
+ *
+ * @param fileName  Name of the trace file.
+ *
+ * @return  true if the file was mapped and has a valid header and index.
+ */
+bool
+BlockTrace::open(
+  const char* const fileName
+)
+{
+  close();
+
+  int fd = ::open(fileName, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if ((fstat(fd, &st) != 0) || (static_cast<size_t>(st.st_size) < sizeof(block_trace_header_t))) {
+    ::close(fd);
+    return false;
+  }
+  void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  m_mapping = mapping;
+  m_mappingSize = st.st_size;
+
+  const block_trace_header_t* header = static_cast<const block_trace_header_t*>(m_mapping);
+  if ((memcmp(header->magic, BLOCK_TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0) ||
+      (header->version != BLOCK_TRACE_VERSION) ||
+      (header->block_records == 0) ||
+      (header->index_offset > m_mappingSize) ||
+      (header->block_count > ((m_mappingSize - header->index_offset) / sizeof(block_trace_index_t))) ||
+      (header->block_count != ((header->instruction_count + header->block_records - 1) / header->block_records))) {
+    close();
+    return false;
+  }
+
+  // the index follows the compressed blocks, at any alignment, so its entries are copied out bytewise
+  const char* index = static_cast<const char*>(m_mapping) + header->index_offset;
+  m_index.resize(header->block_count);
+  for (uint64_t b = 0; b < header->block_count; ++b) {
+    memcpy(&m_index[b], index + (b * sizeof(block_trace_index_t)), sizeof(block_trace_index_t));
+  }
+  uint64_t records = 0;
+  for (std::vector<block_trace_index_t>::const_iterator b = m_index.begin(); b != m_index.end(); ++b) {
+    // every block but the last one is full, and all of them lie before the index
+    bool last = ((b + 1) == m_index.end());
+    if ((b->offset > header->index_offset) || (b->size > (header->index_offset - b->offset)) ||
+        (last ? (b->records > header->block_records) : (b->records != header->block_records))) {
+      close();
+      return false;
+    }
+    records += b->records;
+  }
+  if (records != header->instruction_count) {
+    close();
+    return false;
+  }
+  m_blockRecords = header->block_records;
+  m_instructionCount = header->instruction_count;
+  return true;
+}
+
+/**
+ * @brief Function which unmaps the trace file.
+ */
+void
+BlockTrace::close(
+)
+{
+  if (m_mapping != NULL) {
+    munmap(m_mapping, m_mappingSize);
+  }
+  m_mapping = NULL;
+  m_mappingSize = 0;
+  m_blockRecords = 0;
+  m_instructionCount = 0;
+  m_index.clear();
+}
+
+/**
+ * @brief Function which decompresses one block.
+ *
+ * @param block     Index of the block.
+ * @param records   Buffer for the records of the block.
+ *
+ * @return  true if the block was valid.
+ */
+bool
+BlockTrace::decodeBlock(
+  const uint64_t block,
+  trace_record_t* const records
+) const
+{
+  const block_trace_index_t& entry = m_index[block];
+  std::vector<uint8_t> planes(static_cast<size_t>(entry.records) * sizeof(trace_record_t));
+  if (!lz_decompress(static_cast<const uint8_t*>(m_mapping) + entry.offset, entry.size, planes)) {
+    return false;
+  }
+  join_planes(planes, entry.records, records);
+  return true;
+}
+
+/**
+ * @brief Function which decompresses a range of blocks. The blocks are split
+ *        between the threads, every one of them decompressing into its own
+ *        part of the output.
+ *
+ * @param first     Index of the first block.
+ * @param count     Number of blocks, fewer if the trace ends before.
+ * @param records   Vector in which the records of the blocks are returned.
+ * @param threads   Number of threads to decompress on.
+ *
+ * @return  true if all the blocks were valid.
+ */
+bool
+BlockTrace::decode(
+  const uint64_t first,
+  const uint64_t count,
+  std::vector<trace_record_t>& records,
+  const unsigned threads
+) const
+{
+  uint64_t last = std::min(first + count, static_cast<uint64_t>(m_index.size()));
+  records.clear();
+  if (first >= last) {
+    return true;
+  }
+  uint64_t begin = first * m_blockRecords;
+  uint64_t end = std::min(last * m_blockRecords, m_instructionCount);
+  records.resize(end - begin);
+
+  unsigned workers = static_cast<unsigned>(std::min(static_cast<uint64_t>(std::max(threads, 1u)), last - first));
+  std::vector<char> valid(workers, 1);
+  std::vector<std::thread> pool;
+  for (unsigned w = 1; w < workers; ++w) {
+    pool.push_back(std::thread([this, first, last, workers, w, begin, &records, &valid]() {
+      for (uint64_t b = first + w; b < last; b += workers) {
+        valid[w] = valid[w] && decodeBlock(b, &records[(b * m_blockRecords) - begin]);
+      }
+    }));
+  }
+  for (uint64_t b = first; b < last; b += workers) {
+    valid[0] = valid[0] && decodeBlock(b, &records[(b * m_blockRecords) - begin]);
+  }
+  for (std::vector<std::thread>::iterator t = pool.begin(); t != pool.end(); ++t) {
+    t->join();
+  }
+  return std::find(valid.begin(), valid.end(), 0) == valid.end();
+}
+
+/**
+ * @brief Function which checks if a file starts with the block compressed trace magic.
+ *
+ * @param fileName  Name of the file to be checked.
+ */
+bool
+BlockTrace::isBlockTrace(
+  const char* const fileName
+)
+{
+  char magic[TRACE_MAGIC_SIZE];
+  FILE* f = fopen(fileName, "rb");
+  if (f == NULL) {
+    return false;
+  }
+  bool isBlock = (fread(magic, 1, TRACE_MAGIC_SIZE, f) == TRACE_MAGIC_SIZE) &&
+                 (memcmp(magic, BLOCK_TRACE_MAGIC, TRACE_MAGIC_SIZE) == 0);
+  fclose(f);
+  return isBlock;
+}
@@ -0,0 +1,114 @@
+#ifndef BLOCK_TRACE_HPP
+#define BLOCK_TRACE_HPP
+
+#include "trace.hpp"
+
+#define BLOCK_TRACE_MAGIC "PSIMBLK"
+#define BLOCK_TRACE_VERSION 1
+
+// number of instructions in a block, unless given when writing
+#define DEFAULT_BLOCK_RECORDS 65536
+
+/**
+ * @brief Header at the start of every block compressed trace file. The index
+ *        of the blocks is in the footer, at the given offset.
+ */
+typedef struct _block_trace_header_t {
+  char magic[TRACE_MAGIC_SIZE];
+  uint32_t version;
+  uint32_t block_records;
+  uint64_t instruction_count;
+  uint64_t block_count;
+  uint64_t index_offset;
+} block_trace_header_t;
+
+/**
+ * @brief Entry of the index for one block. Block i starts at instruction
+ *        i * block_records, so the block of any instruction is found directly.
+ */
+typedef struct _block_trace_index_t {
+  uint64_t offset;
+  uint32_t size;
+  uint32_t records;
+} block_trace_index_t;
+
+/**
+ * @brief Writer for block compressed traces. Records are buffered until a
+ *        block is full, then the block is compressed on its own so that it
+ *        can be decompressed without the ones before it.
+ */
+class BlockTraceWriter {
+public:
+  BlockTraceWriter();
+
+  ~BlockTraceWriter();
+
+  bool open(const char* const, const uint32_t);
+
+  bool append(const trace_record_t&);
+
+  bool close();
+
+  uint64_t size() const { return m_instructionCount; }
+
+  uint64_t compressedSize() const { return m_offset; }
+
+private:
+  BlockTraceWriter(const BlockTraceWriter&);
+
+  BlockTraceWriter& operator=(const BlockTraceWriter&);
+
+  bool flush();
+
+private:
+  FILE* m_file;
+  uint32_t m_blockRecords;
+  uint64_t m_instructionCount;
+  uint64_t m_offset;
+
+  std::vector<trace_record_t> m_block;
+  std::vector<block_trace_index_t> m_index;
+};
+
+/**
+ * @brief Read-only, memory mapped view of a block compressed trace file, which
+ *        decompresses any range of blocks, on several threads if asked to.
+ */
+class BlockTrace {
+public:
+  BlockTrace();
+
+  ~BlockTrace();
+
+  bool open(const char* const);
+
+  void close();
+
+  bool decode(const uint64_t, const uint64_t, std::vector<trace_record_t>&, const unsigned) const;
+
+  uint64_t size() const { return m_instructionCount; }
+
+  uint32_t blockRecords() const { return m_blockRecords; }
+
+  uint64_t blockCount() const { return m_index.size(); }
+
+  static bool isBlockTrace(const char* const);
+
+private:
+  // mapping is owned by the instance, so it can not be copied
+  BlockTrace(const BlockTrace&);
+
+  BlockTrace& operator=(const BlockTrace&);
+
+  bool decodeBlock(const uint64_t, trace_record_t* const) const;
+
+private:
+  void* m_mapping;
+  size_t m_mappingSize;
+
+  uint32_t m_blockRecords;
+  uint64_t m_instructionCount;
+  std::vector<block_trace_index_t> m_index;
+};
+
+#endif /* BLOCK_TRACE_HPP */
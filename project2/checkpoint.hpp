@@ -0,0 +1,74 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#define CHECKPOINT_MAGIC "PSIMCKP"
+#define CHECKPOINT_MAGIC_SIZE 8
+#define CHECKPOINT_VERSION 8
+
+/**
+ * @brief Function which writes a plain value to a checkpoint.
+ */
+template <typename T>
+inline
+bool
+write_value(
+  FILE* const f,
+  const T& value
+)
+{
+  return (fwrite(&value, sizeof(T), 1, f) == 1);
+}
+
+/**
+ * @brief Function which reads a plain value from a checkpoint.
+ */
+template <typename T>
+inline
+bool
+read_value(
+  FILE* const f,
+  T& value
+)
+{
+  return (fread(&value, sizeof(T), 1, f) == 1);
+}
+
+/**
+ * @brief Function which writes a vector of plain values, preceded by its size.
+ */
+template <typename T>
+inline
+bool
+write_vector(
+  FILE* const f,
+  const std::vector<T>& values
+)
+{
+  uint64_t size = values.size();
+  return write_value(f, size) && ((size == 0) || (fwrite(values.data(), sizeof(T), size, f) == size));
+}
+
+/**
+ * @brief Function which reads a vector of plain values, preceded by its size.
+ */
+template <typename T>
+inline
+bool
+read_vector(
+  FILE* const f,
+  std::vector<T>& values
+)
+{
+  uint64_t size;
+  if (!read_value(f, size)) {
+    return false;
+  }
+  values.resize(size);
+  return (size == 0) || (fread(values.data(), sizeof(T), size, f) == size);
+}
+
+#endif /* CHECKPOINT_HPP */
@@ -0,0 +1,112 @@
+#include "convergence.hpp"
+
+#include <cmath>
+#include <cstring>
+
+/**
+ * @brief Constructor for a monitor with the given settings.
+ *
+ * @param params  Window, tolerance and budget of the run.
+ */
+ConvergenceMonitor::ConvergenceMonitor(
+  const convergence_params_t& params
+) : m_params(params),
+  m_windowEnd(params.window),
+  m_windowInstructions(0),
+  m_windowCycles(0),
+  m_mean(0.0),
+  m_squares(0.0)
+{
+  memset(&m_result, 0, sizeof(convergence_t));
+}
+
+/**
+ * @brief Function which returns the half width of the confidence interval of the mean CPI.
+ */
+double
+ConvergenceMonitor::halfWidth(
+) const
+{
+  if (m_result.windows < 2) {
+    return HUGE_VAL;
+  }
+  double variance = m_squares / (m_result.windows - 1);
+  return CONVERGENCE_Z * sqrt(variance / m_result.windows);
+}
+
+/**
+ * @brief Function which ends the current window, and tells if the run can stop.
+ *        Windows end at the first cycle in which enough instructions have
+ *        retired, so they are weighed by their actual number of instructions.
+ *
+ * @param instructions  Number of instructions retired so far.
+ * @param cycles        Number of cycles simulated so far.
+ *
+ * @return  true if the IPC has converged or the budget is spent.
+ */
+bool
+ConvergenceMonitor::closeWindow(
+  const uint64_t instructions,
+  const uint64_t cycles
+)
+{
+  m_windowEnd = instructions + m_params.window;
+  if (m_windowInstructions > 0) {
+    double cpi = static_cast<double>(cycles - m_windowCycles) / (instructions - m_windowInstructions);
+    ++m_result.windows;
+    double delta = cpi - m_mean;
+    m_mean += delta / m_result.windows;
+    m_squares += delta * (cpi - m_mean);
+  }
+  m_windowInstructions = instructions;
+  m_windowCycles = cycles;
+  estimate(instructions, cycles);
+
+  // the interval is on the CPI, its relative width is the same for the IPC
+  m_result.converged = (m_result.windows >= CONVERGENCE_MIN_WINDOWS) &&
+                       (halfWidth() <= m_params.tolerance * m_mean);
+  return m_result.converged || ((m_params.budget > 0) && (instructions >= m_params.budget));
+}
+
+/**
+ * @brief Function which computes the estimate from the windows measured so far.
+ *
+ * @param instructions  Number of instructions retired so far.
+ * @param cycles        Number of cycles simulated so far.
+ */
+void
+ConvergenceMonitor::estimate(
+  const uint64_t instructions,
+  const uint64_t cycles
+)
+{
+  m_result.instructions = instructions;
+  m_result.cycles = cycles;
+  if (m_result.windows < 2) {
+    // too few windows to bound the error, the IPC so far is the best guess
+    m_result.ipc = static_cast<double>(instructions) / cycles;
+    m_result.error = m_result.ipc;
+    return;
+  }
+  m_result.ipc = 1.0 / m_mean;
+  m_result.error = m_result.ipc * halfWidth() / m_mean;
+}
+
+/**
+ * @brief Function which is called when all the instructions have executed
+ *        before the run could stop, the IPC of the whole run is then exact.
+ *
+ * @param instructions  Number of instructions retired.
+ * @param cycles        Number of cycles simulated.
+ */
+void
+ConvergenceMonitor::complete(
+  const uint64_t instructions,
+  const uint64_t cycles
+)
+{
+  m_result.instructions = instructions;
+  m_result.cycles = cycles;
+  m_result.ipc = (cycles > 0) ? (static_cast<double>(instructions) / cycles) : 0.0;
+  m_result.error = 0.0;
+}
@@ -0,0 +1,91 @@
+#ifndef CONVERGENCE_HPP
+#define CONVERGENCE_HPP
+
+#include <cstdint>
+
+// number of retired instructions in a window, unless given
+#define DEFAULT_CONVERGENCE_WINDOW 10000
+
+// windows measured before the confidence interval is trusted, the first window
+// is not measured since it includes filling the pipeline
+#define CONVERGENCE_MIN_WINDOWS 4
+
+// two sided 95% confidence for a normally distributed mean
+#define CONVERGENCE_Z 1.96
+
+/**
+ * @brief Struct for storing the settings of a run which stops early once its IPC has converged.
+ */
+typedef struct _convergence_params_t {
+  // number of retired instructions in a window
+  uint64_t window;
+  // relative half width of the confidence interval at which the run stops
+  double tolerance;
+  // number of retired instructions at which the run stops anyway, 0 for no limit
+  uint64_t budget;
+} convergence_params_t;
+
+/**
+ * @brief Struct for storing the estimate of a run which may have stopped early.
+ */
+typedef struct _convergence_t {
+  // true if the confidence interval fell below the tolerance
+  bool converged;
+  // number of measured windows, and the instructions and cycles when the run stopped
+  uint64_t windows;
+  uint64_t instructions;
+  uint64_t cycles;
+  // estimate of the IPC, and the half width of its confidence interval
+  double ipc;
+  double error;
+} convergence_t;
+
+/**
+ * @brief Monitor which measures the CPI of every window of retired instructions
+ *        and keeps a running confidence interval of their mean, in the way of
+ *        Welford, to tell when a run can stop.
+ */
+class ConvergenceMonitor {
+public:
+  ConvergenceMonitor(const convergence_params_t&);
+
+  /**
+   * @brief Function which is called after every cycle, and tells if the run can stop.
+   *
+   * @param instructions  Number of instructions retired so far.
+   * @param cycles        Number of cycles simulated so far.
+   */
+  bool update(const uint64_t instructions, const uint64_t cycles)
+  {
+    if (instructions < m_windowEnd) {
+      return false;
+    }
+    return closeWindow(instructions, cycles);
+  }
+
+  void complete(const uint64_t, const uint64_t);
+
+  const convergence_t& result() const { return m_result; }
+
+private:
+  bool closeWindow(const uint64_t, const uint64_t);
+
+  void estimate(const uint64_t, const uint64_t);
+
+  double halfWidth() const;
+
+private:
+  convergence_params_t m_params;
+
+  uint64_t m_windowEnd;
+  uint64_t m_windowInstructions;
+  uint64_t m_windowCycles;
+
+  // running mean of the CPI of the windows, and the sum of its squared deviations
+  double m_mean;
+  double m_squares;
+
+  convergence_t m_result;
+};
+
+#endif /* CONVERGENCE_HPP */
@@ -0,0 +1,469 @@
+#include "dataflow.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <queue>
+
+/**
+ * @brief Slots of a greedy schedule, one per cycle in which instructions fire,
+ *        each with a limited number of FUs of every type and result buses.
+ *        Full slots are skipped through a union-find, so that the schedule stays
+ *        linear in the number of instructions even when one resource is scarce.
+ */
+class SlotSchedule {
+public:
+  SlotSchedule(const sweep_config_t& config)
+    : m_config(config)
+  {
+  }
+
+  /**
+   * @brief Function which reserves an FU of the given type and a result bus in
+   *        the first slot at or after the given cycle where both are free.
+   *
+   * @param type      Type of FU to be reserved.
+   * @param earliest  First cycle in which the instruction can fire.
+   *
+   * @return  cycle in which the instruction fires.
+   */
+  uint64_t
+  reserve(
+    const uint32_t type,
+    const uint64_t earliest
+  )
+  {
+    uint64_t slot = find(type, earliest);
+    if (++m_used[type][slot] == m_config.k[type]) {
+      close(type, slot);
+    }
+    if (++m_buses[slot] == m_config.r) {
+      for (uint32_t t = 0; t < NUM_FU_TYPES; ++t) {
+        close(t, slot);
+      }
+    }
+    return slot;
+  }
+
+private:
+  void
+  grow(
+    const uint64_t slot
+  )
+  {
+    while (m_buses.size() <= slot + 1) {
+      uint64_t next = m_buses.size();
+      m_buses.push_back(0);
+      for (uint32_t t = 0; t < NUM_FU_TYPES; ++t) {
+        m_used[t].push_back(0);
+        m_next[t].push_back(next);
+      }
+    }
+  }
+
+  uint64_t
+  find(
+    const uint32_t type,
+    const uint64_t slot
+  )
+  {
+    grow(slot);
+    std::vector<uint64_t>& next = m_next[type];
+    uint64_t root = slot;
+    while (next[root] != root) {
+      root = next[root];
+      grow(root);
+    }
+    // compress the path, so that the full slots are skipped in one step next time
+    for (uint64_t s = slot; s != root;) {
+      uint64_t n = next[s];
+      next[s] = root;
+      s = n;
+    }
+    return root;
+  }
+
+  void
+  close(
+    const uint32_t type,
+    const uint64_t slot
+  )
+  {
+    grow(slot);
+    m_next[type][slot] = slot + 1;
+  }
+
+private:
+  const sweep_config_t& m_config;
+
+  std::vector<uint64_t> m_used[NUM_FU_TYPES];
+  std::vector<uint64_t> m_buses;
+  std::vector<uint64_t> m_next[NUM_FU_TYPES];
+};
+
+/**
+ * @brief Struct for storing the last value written to an architectural register.
+ */
+typedef struct _dataflow_value_t {
+  bool written;
+  uint64_t producer;
+  uint64_t level;
+  uint64_t fire;
+  uint64_t reads;
+} dataflow_value_t;
+
+static void
+retire_value(
+  const dataflow_value_t& value,
+  dataflow_stats_t* const p_stats
+)
+{
+  p_stats->reads_per_value.record(value.reads);
+  if (value.reads == 0) {
+    ++p_stats->dead_values;
+  }
+}
+
+/**
+ * @brief Function which analyzes the dataflow of a trace in a single pass, by
+ *        following the producers of every register. The critical path assumes
+ *        unlimited resources and a latency of one cycle, so that dependent
+ *        instructions fire DATAFLOW_DEPENDENCY_CYCLES apart as in the simulator.
+ *
+ * @param begin     First record of the trace.
+ * @param end       Record after the last one of the trace.
+ * @param config    Configuration for the constrained schedule, or NULL.
+ * @param p_stats   Pointer to the statistics structure to populate.
+ */
+void
+analyze_dataflow(
+  const trace_record_t* const begin,
+  const trace_record_t* const end,
+  const sweep_config_t* const config,
+  dataflow_stats_t* const p_stats
+)
+{
+  p_stats->instructions = 0;
+  memset(p_stats->fu_instructions, 0, sizeof(p_stats->fu_instructions));
+  p_stats->critical_path = 0;
+  p_stats->ilp = 0.0;
+  p_stats->ipc_limit = 0.0;
+  p_stats->constrained_cycles = 0;
+  p_stats->constrained_ipc = 0.0;
+  p_stats->dependency_distance = Histogram();
+  memset(p_stats->distance_buckets, 0, sizeof(p_stats->distance_buckets));
+  p_stats->reads_per_value = Histogram();
+  p_stats->overwrite_distance = Histogram();
+  p_stats->dead_values = 0;
+
+  std::unique_ptr<SlotSchedule> schedule;
+  if (config != NULL) {
+    schedule.reset(new SlotSchedule(*config));
+  }
+
+  std::vector<dataflow_value_t> registers;
+  uint64_t lastFire = 0;
+  for (const trace_record_t* record = begin; record != end; ++record) {
+    const uint64_t index = p_stats->instructions++;
+    // use functional unit 1 for instructions of type -1, as the simulator does
+    const uint32_t type = (record->op_code == -1) ? 1 : static_cast<uint32_t>(record->op_code);
+    ++p_stats->fu_instructions[type];
+
+    uint64_t level = 0;
+    // an instruction is fetched, dispatched and scheduled before it fires
+    uint64_t earliest = (config != NULL) ? ((index / config->f) + 3) : 0;
+    for (uint32_t i = 0; i < 2; ++i) {
+      int32_t src = record->src_reg[i];
+      if ((src < 0) || (static_cast<size_t>(src) >= registers.size()) || !registers[src].written) {
+        continue;
+      }
+      dataflow_value_t& value = registers[src];
+      ++value.reads;
+      uint64_t distance = index - value.producer;
+      p_stats->dependency_distance.record(distance);
+      uint32_t bucket = 63 - __builtin_clzll(distance);
+      ++p_stats->distance_buckets[std::min(bucket, static_cast<uint32_t>(DATAFLOW_DISTANCE_BUCKETS - 1))];
+      level = std::max(level, value.level);
+      earliest = std::max(earliest, value.fire + DATAFLOW_DEPENDENCY_CYCLES);
+    }
+    ++level;
+    p_stats->critical_path = std::max(p_stats->critical_path, level);
+
+    uint64_t fire = 0;
+    if (schedule) {
+      fire = schedule->reserve(type, earliest);
+      lastFire = std::max(lastFire, fire);
+    }
+
+    int32_t dest = record->dest_reg;
+    if (dest < 0) {
+      continue;
+    }
+    if (static_cast<size_t>(dest) >= registers.size()) {
+      dataflow_value_t empty = {false, 0, 0, 0, 0};
+      registers.resize(dest + 1, empty);
+    }
+    dataflow_value_t& value = registers[dest];
+    if (value.written) {
+      p_stats->overwrite_distance.record(index - value.producer);
+      retire_value(value, p_stats);
+    }
+    value.written = true;
+    value.producer = index;
+    value.level = level;
+    value.fire = fire;
+    value.reads = 0;
+  }
+
+  // the values still in the registers at the end of the trace are counted as well
+  for (std::vector<dataflow_value_t>::const_iterator it = registers.begin(); it != registers.end(); ++it) {
+    if (it->written) {
+      retire_value(*it, p_stats);
+    }
+  }
+
+  if (p_stats->critical_path > 0) {
+    p_stats->ilp = static_cast<double>(p_stats->instructions) / p_stats->critical_path;
+    p_stats->ipc_limit = p_stats->ilp / DATAFLOW_DEPENDENCY_CYCLES;
+  }
+  if (schedule && (p_stats->instructions > 0)) {
+    // the last instruction executes and updates the state after firing
+    p_stats->constrained_cycles = lastFire + 2;
+    p_stats->constrained_ipc = static_cast<double>(p_stats->instructions) / p_stats->constrained_cycles;
+  }
+}
+
+/**
+ * @brief Function which computes the highest IPC the resources of a
+ *        configuration can sustain on a trace, regardless of its dependencies.
+ *        Every instruction is fetched, fires on an FU of its type and takes a
+ *        result bus, so the fetch rate, the result buses, the FUs together and
+ *        the FUs of the busiest type all bound the IPC.
+ *
+ * @param stats   Dataflow statistics of the trace.
+ * @param config  Configuration of the processor.
+ *
+ * @return  upper bound on the IPC from the resources alone.
+ */
+double
+resource_ipc_limit(
+  const dataflow_stats_t& stats,
+  const sweep_config_t& config
+)
+{
+  double limit = static_cast<double>(std::min(config.f, config.r));
+  limit = std::min(limit, static_cast<double>(config.k[0] + config.k[1] + config.k[2]));
+  for (uint32_t t = 0; t < NUM_FU_TYPES; ++t) {
+    if (stats.fu_instructions[t] > 0) {
+      limit = std::min(limit, static_cast<double>(stats.instructions) * config.k[t] / stats.fu_instructions[t]);
+    }
+  }
+  return limit;
+}
+
+/**
+ * @brief Function which computes the highest IPC a trace can reach when at most
+ *        window instructions are in the scheduling queue at once, with unlimited
+ *        FUs and result buses. Every instruction gets lower bounds on the cycles
+ *        in which it enters the queue, fires and leaves it, following the
+ *        simulator: it enters in order, no earlier than 2 cycles after it is
+ *        fetched nor than 2 cycles after enough of the older instructions have
+ *        left to make room for it, fires in the cycle after entering and
+ *        DATAFLOW_DEPENDENCY_CYCLES after its producers, and leaves in the
+ *        cycle after firing.
+ *
+ * @param begin   First record of the trace.
+ * @param end     Record after the last one of the trace.
+ * @param f       Number of instructions fetched per cycle.
+ * @param window  Number of entries of the scheduling queue.
+ *
+ * @return  upper bound on the IPC of the trace.
+ */
+double
+window_ipc_limit(
+  const trace_record_t* const begin,
+  const trace_record_t* const end,
+  const uint64_t f,
+  const uint64_t window
+)
+{
+  // cycle in which the last value written to every register fired, if it was written
+  std::vector<std::pair<bool, uint64_t> > registers;
+  // cycles in which the instructions leave the queue, split so that the largest
+  // of the smallest ones is the departure which makes room for the next instruction
+  std::priority_queue<uint64_t> departed;
+  std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t> > later;
+
+  uint64_t instructions = 0;
+  uint64_t enter = 0;
+  uint64_t cycles = 0;
+  for (const trace_record_t* record = begin; record != end; ++record) {
+    const uint64_t index = instructions++;
+    enter = std::max(enter, (index / f) + 3);
+    if (index >= window) {
+      enter = std::max(enter, departed.top() + 2);
+    }
+
+    uint64_t fire = enter + 1;
+    for (uint32_t i = 0; i < 2; ++i) {
+      int32_t src = record->src_reg[i];
+      if ((src >= 0) && (static_cast<size_t>(src) < registers.size()) && registers[src].first) {
+        fire = std::max(fire, registers[src].second + DATAFLOW_DEPENDENCY_CYCLES);
+      }
+    }
+    const uint64_t leave = fire + 1;
+    cycles = std::max(cycles, leave);
+
+    int32_t dest = record->dest_reg;
+    if (dest >= 0) {
+      if (static_cast<size_t>(dest) >= registers.size()) {
+        registers.resize(dest + 1, std::make_pair(false, 0));
+      }
+      registers[dest] = std::make_pair(true, fire);
+    }
+
+    // the next instruction enters once index + 2 - window of the older ones have left
+    if (!departed.empty() && (leave < departed.top())) {
+      departed.push(leave);
+      later.push(departed.top());
+      departed.pop();
+    }
+    else {
+      later.push(leave);
+    }
+    while ((index + 2 > window) && (departed.size() < index + 2 - window)) {
+      departed.push(later.top());
+      later.pop();
+    }
+  }
+  return (cycles > 0) ? (static_cast<double>(instructions) / cycles) : 0.0;
+}
+
+/**
+ * @brief Function which computes an upper bound on the IPC of every
+ *        configuration of a sweep on a trace, the lower of the bounds from its
+ *        resources and from the window of its scheduling queue.
+ *
+ * @param begin     First record of the trace.
+ * @param end       Record after the last one of the trace.
+ * @param stats     Dataflow statistics of the trace.
+ * @param configs   Configurations of the sweep.
+ *
+ * @return  upper bound on the IPC of every configuration.
+ */
+std::vector<double>
+configuration_ipc_limits(
+  const trace_record_t* const begin,
+  const trace_record_t* const end,
+  const dataflow_stats_t& stats,
+  const std::vector<sweep_config_t>& configs
+)
+{
+  // the window bound only depends on the fetch rate and the size of the queue
+  std::map<std::pair<uint64_t, uint64_t>, double> windowLimits;
+  std::vector<double> limits(configs.size());
+  for (size_t c = 0; c < configs.size(); ++c) {
+    const sweep_config_t& config = configs[c];
+    std::pair<uint64_t, uint64_t> window(config.f, DATAFLOW_QUEUE_ENTRIES_PER_FU * (config.k[0] + config.k[1] + config.k[2]));
+    std::map<std::pair<uint64_t, uint64_t>, double>::const_iterator it = windowLimits.find(window);
+    if (it == windowLimits.end()) {
+      it = windowLimits.insert(std::make_pair(window, window_ipc_limit(begin, end, window.first, window.second))).first;
+    }
+    limits[c] = std::min(it->second, resource_ipc_limit(stats, config));
+  }
+  return limits;
+}
+
+static bool
+dominates(
+  const sweep_config_t& smaller,
+  const sweep_config_t& config
+)
+{
+  return (smaller.r <= config.r) && (smaller.f <= config.f) && (smaller.k[0] <= config.k[0]) &&
+         (smaller.k[1] <= config.k[1]) && (smaller.k[2] <= config.k[2]);
+}
+
+/**
+ * @brief Function which finds the next configurations of a sweep to simulate
+ *        while looking for ones that reach the IPC limits of larger ones. These
+ *        are the smallest ones, not yet simulated nor pruned, whose own limit
+ *        is within the tolerance of the limit of a larger one, as only such a
+ *        configuration can prune another.
+ *
+ * @param limits      Upper bound on the IPC of every configuration.
+ * @param configs     Configurations of the sweep.
+ * @param ipc         Simulated IPC of every configuration, negative if not simulated.
+ * @param tolerance   Fraction of the dataflow limit which may be given up.
+ *
+ * @return  one flag per configuration, set if it is to be simulated next.
+ */
+std::vector<bool>
+next_configurations(
+  const std::vector<double>& limits,
+  const std::vector<sweep_config_t>& configs,
+  const std::vector<double>& ipc,
+  const double tolerance
+)
+{
+  std::vector<bool> pruned = prune_configurations(limits, configs, ipc, tolerance);
+  std::vector<bool> candidate(configs.size(), false);
+  for (size_t c = 0; c < configs.size(); ++c) {
+    if ((ipc[c] >= 0.0) || pruned[c]) {
+      continue;
+    }
+    for (size_t l = 0; !candidate[c] && (l < configs.size()); ++l) {
+      candidate[c] = (l != c) && (ipc[l] < 0.0) && !pruned[l] && dominates(configs[c], configs[l]) &&
+                     (limits[c] >= (1.0 - tolerance) * limits[l]);
+    }
+  }
+
+  std::vector<bool> next(candidate);
+  for (size_t c = 0; c < configs.size(); ++c) {
+    for (size_t s = 0; next[c] && (s < configs.size()); ++s) {
+      if ((s != c) && candidate[s] && dominates(configs[s], configs[c])) {
+        next[c] = false;
+      }
+    }
+  }
+  return next;
+}
+
+/**
+ * @brief Function which finds the configurations of a sweep which can not
+ *        perform noticeably better than a smaller one. No configuration exceeds
+ *        its IPC limit, so once a configuration reaches the limit of one with
+ *        at least as many resources of every kind within the tolerance, the
+ *        larger one is at most tolerance / (1 - tolerance) faster.
+ *
+ * @param limits      Upper bound on the IPC of every configuration.
+ * @param configs     Configurations of the sweep.
+ * @param ipc         Simulated IPC of every configuration, negative if not simulated.
+ * @param tolerance   Fraction of the dataflow limit which may be given up.
+ *
+ * @return  one flag per configuration, set if it can be skipped.
+ */
+std::vector<bool>
+prune_configurations(
+  const std::vector<double>& limits,
+  const std::vector<sweep_config_t>& configs,
+  const std::vector<double>& ipc,
+  const double tolerance
+)
+{
+  std::vector<bool> pruned(configs.size(), false);
+  for (size_t c = 0; c < configs.size(); ++c) {
+    if (ipc[c] >= 0.0) {
+      continue;
+    }
+    for (size_t s = 0; s < configs.size(); ++s) {
+      if ((ipc[s] >= (1.0 - tolerance) * limits[c]) && dominates(configs[s], configs[c])) {
+        pruned[c] = true;
+        break;
+      }
+    }
+  }
+  return pruned;
+}
@@ -0,0 +1,62 @@
+#ifndef DATAFLOW_HPP
+#define DATAFLOW_HPP
+
+#include "histogram.hpp"
+#include "sweep.hpp"
+#include "trace.hpp"
+
+// dependency distances are counted in power of two buckets, the last one holds all the longer ones
+#define DATAFLOW_DISTANCE_BUCKETS 16
+
+// cycles from the firing of an instruction to the firing of a dependent one, with
+// a latency of one cycle the result is broadcast in the cycle after firing
+#define DATAFLOW_DEPENDENCY_CYCLES 2
+
+// entries of the scheduling queue per FU, as in the simulator
+#define DATAFLOW_QUEUE_ENTRIES_PER_FU 2
+
+/**
+ * @brief Struct for storing what the dataflow of a trace allows
+ */
+typedef struct _dataflow_stats_t {
+  uint64_t instructions;
+  // instructions executed on each type of FUs
+  uint64_t fu_instructions[NUM_FU_TYPES];
+
+  // length of the longest chain of dependent instructions, and the average
+  // number of instructions per link of the chain
+  uint64_t critical_path;
+  double ilp;
+  // upper bound on the IPC of any configuration, from the critical path alone
+  double ipc_limit;
+
+  // cycles and IPC of a greedy schedule, in the order of the trace with an
+  // unlimited window, for the FU counts, result buses and fetch rate of a
+  // configuration, zero if no configuration was given
+  uint64_t constrained_cycles;
+  double constrained_ipc;
+
+  // distances, in instructions, from the consumers to the producers of their operands
+  Histogram dependency_distance;
+  uint64_t distance_buckets[DATAFLOW_DISTANCE_BUCKETS];
+  // number of times each value written to a register is read, and the number of
+  // instructions until the register is written again
+  Histogram reads_per_value;
+  Histogram overwrite_distance;
+  uint64_t dead_values;
+} dataflow_stats_t;
+
+void analyze_dataflow(const trace_record_t* const, const trace_record_t* const, const sweep_config_t* const, dataflow_stats_t* const);
+
+double resource_ipc_limit(const dataflow_stats_t&, const sweep_config_t&);
+
+double window_ipc_limit(const trace_record_t* const, const trace_record_t* const, const uint64_t, const uint64_t);
+
+std::vector<double> configuration_ipc_limits(const trace_record_t* const, const trace_record_t* const,
+                                             const dataflow_stats_t&, const std::vector<sweep_config_t>&);
+
+std::vector<bool> next_configurations(const std::vector<double>&, const std::vector<sweep_config_t>&, const std::vector<double>&, const double);
+
+std::vector<bool> prune_configurations(const std::vector<double>&, const std::vector<sweep_config_t>&, const std::vector<double>&, const double);
+
+#endif /* DATAFLOW_HPP */
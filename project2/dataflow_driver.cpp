@@ -0,0 +1,101 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "dataflow.hpp"
+
+void print_help_and_exit(void) {
+    printf("dataflow [OPTIONS]\n");
+    printf("  -i traces/file.trace\tText or binary trace to analyze\n");
+    printf("  -j k0\t\tNumber of k0 FUs for the constrained schedule\n");
+    printf("  -k k1\t\tNumber of k1 FUs for the constrained schedule\n");
+    printf("  -l k2\t\tNumber of k2 FUs for the constrained schedule\n");
+    printf("  -f N\t\tNumber of instructions to fetch for the constrained schedule\n");
+    printf("  -r R\t\tNumber of result buses for the constrained schedule\n");
+    printf("  -h\t\tThis helpful output\n");
+    exit(0);
+}
+
+void print_histogram(const char* name, const Histogram& histogram) {
+    printf("%s: mean %.2f, p50 %" PRIu64 ", p90 %" PRIu64 ", p99 %" PRIu64 ", max %" PRIu64 "\n", name,
+           histogram.mean(), histogram.percentile(50), histogram.percentile(90), histogram.percentile(99),
+           histogram.max());
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    const char* traceName = NULL;
+    sweep_config_t config = {0, 0, {0, 0, 0}};
+
+    while(-1 != (opt = getopt(argc, argv, "i:j:k:l:f:r:h"))) {
+        switch(opt) {
+        case 'i':
+            traceName = optarg;
+            break;
+        case 'j':
+            config.k[0] = strtoull(optarg, NULL, 10);
+            break;
+        case 'k':
+            config.k[1] = strtoull(optarg, NULL, 10);
+            break;
+        case 'l':
+            config.k[2] = strtoull(optarg, NULL, 10);
+            break;
+        case 'f':
+            config.f = strtoull(optarg, NULL, 10);
+            break;
+        case 'r':
+            config.r = strtoull(optarg, NULL, 10);
+            break;
+        case 'h':
+            /* Fall through */
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+
+    /* The constrained schedule needs all the resources, or none of them */
+    bool constrained = (config.r > 0) || (config.f > 0) || (config.k[0] > 0) || (config.k[1] > 0) || (config.k[2] > 0);
+    if ((traceName == NULL) ||
+        (constrained && ((config.r == 0) || (config.f == 0) || (config.k[0] == 0) || (config.k[1] == 0) || (config.k[2] == 0)))) {
+        print_help_and_exit();
+    }
+
+    TraceBuffer trace;
+    if (!trace.load(traceName)) {
+        fprintf(stderr, "Failed to load trace %s\n", traceName);
+        return 1;
+    }
+
+    dataflow_stats_t stats;
+    analyze_dataflow(trace.begin(), trace.end(), constrained ? &config : NULL, &stats);
+
+    printf("Instructions: %" PRIu64 "\n", stats.instructions);
+    for (int t = 0; t < NUM_FU_TYPES; ++t) {
+        printf("k%d instructions: %" PRIu64 "\n", t, stats.fu_instructions[t]);
+    }
+    printf("Critical path: %" PRIu64 " instructions\n", stats.critical_path);
+    printf("ILP: %f\n", stats.ilp);
+    printf("Dataflow IPC limit: %f\n", stats.ipc_limit);
+    if (constrained) {
+        printf("Resource IPC limit: %f\n", resource_ipc_limit(stats, config));
+        printf("Window IPC limit: %f\n", window_ipc_limit(trace.begin(), trace.end(), config.f,
+               DATAFLOW_QUEUE_ENTRIES_PER_FU * (config.k[0] + config.k[1] + config.k[2])));
+        printf("Constrained schedule: %" PRIu64 " cycles, IPC %f\n", stats.constrained_cycles, stats.constrained_ipc);
+    }
+
+    print_histogram("Dependency distance", stats.dependency_distance);
+    for (int b = 0; b < DATAFLOW_DISTANCE_BUCKETS; ++b) {
+        if (b < DATAFLOW_DISTANCE_BUCKETS - 1) {
+            printf("  [%" PRIu64 ", %" PRIu64 "): %" PRIu64 "\n", UINT64_C(1) << b, UINT64_C(1) << (b + 1), stats.distance_buckets[b]);
+        }
+        else {
+            printf("  [%" PRIu64 ", ...): %" PRIu64 "\n", UINT64_C(1) << b, stats.distance_buckets[b]);
+        }
+    }
+    print_histogram("Reads per value", stats.reads_per_value);
+    print_histogram("Overwrite distance", stats.overwrite_distance);
+    printf("Dead values: %" PRIu64 "\n", stats.dead_values);
+    return 0;
+}
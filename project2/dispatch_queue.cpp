@@ -0,0 +1,92 @@
+#include "dispatch_queue.hpp"
+
+#include "checkpoint.hpp"
+
+// smallest ring of an unbounded queue
+#define MIN_RING_SIZE 64
+
+/**
+ * @brief Default constructor, creates an unbounded queue.
+ */
+DispatchQueue::DispatchQueue(
+) : m_slots(MIN_RING_SIZE),
+  m_capacity(UNBOUNDED_DISPATCH_QUEUE),
+  m_mask(MIN_RING_SIZE - 1),
+  m_head(0),
+  m_size(0)
+{
+}
+
+/**
+ * @brief Constructor for a queue which holds at most the given number of instructions.
+ *
+ * @param capacity  Capacity of the dispatch queue, or UNBOUNDED_DISPATCH_QUEUE.
+ */
+DispatchQueue::DispatchQueue(
+  const uint64_t capacity
+) : m_slots(),
+  m_capacity(capacity),
+  m_mask(0),
+  m_head(0),
+  m_size(0)
+{
+  uint64_t size = (capacity == UNBOUNDED_DISPATCH_QUEUE) ? MIN_RING_SIZE : 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  m_slots.resize(size);
+  m_mask = size - 1;
+}
+
+/**
+ * @brief Function which doubles the ring of an unbounded queue, keeping its
+ *        instructions in order from the start of the new ring.
+ */
+void
+DispatchQueue::grow(
+)
+{
+  std::vector<proc_inst_t> ring(2 * m_slots.size());
+  for (size_t i = 0; i < m_size; ++i) {
+    ring[i] = m_slots[(m_head + i) & m_mask];
+  }
+  m_slots.swap(ring);
+  m_mask = m_slots.size() - 1;
+  m_head = 0;
+}
+
+/**
+ * @brief Function which writes the queue to a checkpoint.
+ *
+ * @param f   Checkpoint file.
+ */
+bool
+DispatchQueue::save(
+  FILE* const f
+) const
+{
+  uint64_t size = m_size;
+  return write_vector(f, m_slots) && write_value(f, m_capacity) && write_value(f, m_mask) &&
+         write_value(f, m_head) && write_value(f, size);
+}
+
+/**
+ * @brief Function which reads the queue from a checkpoint, written by a queue
+ *        of the same capacity.
+ *
+ * @param f   Checkpoint file.
+ */
+bool
+DispatchQueue::load(
+  FILE* const f
+)
+{
+  uint64_t capacity, size;
+  if (!(read_vector(f, m_slots) && read_value(f, capacity) && read_value(f, m_mask) &&
+        read_value(f, m_head) && read_value(f, size))) {
+    return false;
+  }
+  m_size = size;
+  // the ring has to agree with the mask, and hold the instructions
+  return (capacity == m_capacity) && (m_slots.size() == (m_mask + 1)) && (m_size <= m_slots.size());
+}
@@ -0,0 +1,70 @@
+#ifndef DISPATCH_QUEUE_HPP
+#define DISPATCH_QUEUE_HPP
+
+#include "procsim.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// capacity of a dispatch queue which never fills
+#define UNBOUNDED_DISPATCH_QUEUE 0
+
+/**
+ * @brief Dispatch queue backed by a ring of preallocated instructions. A bounded
+ *        queue allocates its ring once and is full once it holds its capacity,
+ *        an unbounded queue doubles its ring when it runs out of slots.
+ */
+class DispatchQueue {
+public:
+  DispatchQueue();
+
+  explicit DispatchQueue(const uint64_t);
+
+  size_t size() const { return m_size; }
+
+  bool empty() const { return m_size == 0; }
+
+  bool full() const { return (m_capacity != UNBOUNDED_DISPATCH_QUEUE) && (m_size >= m_capacity); }
+
+  uint64_t capacity() const { return m_capacity; }
+
+  size_t allocatedBytes() const { return m_slots.capacity() * sizeof(proc_inst_t); }
+
+  const proc_inst_t& front() const { return m_slots[m_head & m_mask]; }
+
+  void push(const proc_inst_t& inst)
+  {
+    if (m_size > m_mask) {
+      grow();
+    }
+    m_slots[(m_head + m_size) & m_mask] = inst;
+    ++m_size;
+  }
+
+  void pop()
+  {
+    ++m_head;
+    --m_size;
+  }
+
+  bool save(FILE* const) const;
+
+  bool load(FILE* const);
+
+private:
+  void grow();
+
+private:
+  std::vector<proc_inst_t> m_slots;
+
+  uint64_t m_capacity;
+  uint64_t m_mask;
+  // position of the oldest instruction, the slot is given by the position modulo the ring size
+  uint64_t m_head;
+
+  size_t m_size;
+};
+
+#endif /* DISPATCH_QUEUE_HPP */
@@ -0,0 +1,88 @@
+#include "histogram.hpp"
+
+#include "checkpoint.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Default constructor for an empty histogram.
+ */
+Histogram::Histogram(
+) : m_counts(HISTOGRAM_BUCKETS, 0),
+  m_count(0),
+  m_sum(0),
+  m_max(0)
+{
+}
+
+/**
+ * @brief Function which returns the largest value counted in a bucket.
+ *
+ * @param index   Index of the bucket.
+ */
+uint64_t
+Histogram::highestValue(
+  const uint32_t index
+)
+{
+  if (index < (2 * HISTOGRAM_SUB_BUCKETS)) {
+    return index;
+  }
+  uint32_t shift = (index / HISTOGRAM_SUB_BUCKETS) - 1;
+  uint64_t low = static_cast<uint64_t>((index % HISTOGRAM_SUB_BUCKETS) + HISTOGRAM_SUB_BUCKETS) << shift;
+  return low + ((static_cast<uint64_t>(1) << shift) - 1);
+}
+
+/**
+ * @brief Function which returns the value below which the given percentage
+ *        of the recorded values lie, rounded up to the end of its bucket.
+ *
+ * @param percent   Percentage, between 0 and 100.
+ */
+uint64_t
+Histogram::percentile(
+  const double percent
+) const
+{
+  if (m_count == 0) {
+    return 0;
+  }
+  uint64_t target = static_cast<uint64_t>(std::ceil(percent / 100.0 * m_count));
+  target = std::min(std::max(target, static_cast<uint64_t>(1)), m_count);
+  uint64_t seen = 0;
+  for (uint32_t b = 0; b < m_counts.size(); ++b) {
+    seen += m_counts[b];
+    if (seen >= target) {
+      return std::min(highestValue(b), m_max);
+    }
+  }
+  return m_max;
+}
+
+/**
+ * @brief Function which writes the histogram to a checkpoint.
+ *
+ * @param f   Checkpoint file.
+ */
+bool
+Histogram::save(
+  FILE* const f
+) const
+{
+  return write_vector(f, m_counts) && write_value(f, m_count) && write_value(f, m_sum) && write_value(f, m_max);
+}
+
+/**
+ * @brief Function which reads the histogram from a checkpoint.
+ *
+ * @param f   Checkpoint file.
+ */
+bool
+Histogram::load(
+  FILE* const f
+)
+{
+  return read_vector(f, m_counts) && read_value(f, m_count) && read_value(f, m_sum) && read_value(f, m_max) &&
+         (m_counts.size() == HISTOGRAM_BUCKETS);
+}
@@ -0,0 +1,67 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// values below 2^(HISTOGRAM_SUB_BITS + 1) are counted exactly, larger values in
+// buckets whose width is at most 1/2^HISTOGRAM_SUB_BITS of the value
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((65 - HISTOGRAM_SUB_BITS) * HISTOGRAM_SUB_BUCKETS)
+
+/**
+ * @brief Fixed memory histogram of non-negative values, with log-linear buckets
+ *        in the style of HdrHistogram, so that percentiles are accurate to a
+ *        few percent over the whole range of values.
+ */
+class Histogram {
+public:
+  Histogram();
+
+  void record(const uint64_t value)
+  {
+    ++m_counts[bucket(value)];
+    ++m_count;
+    m_sum += value;
+    if (value > m_max) {
+      m_max = value;
+    }
+  }
+
+  uint64_t count() const { return m_count; }
+
+  uint64_t max() const { return m_max; }
+
+  double mean() const { return (m_count > 0) ? (static_cast<double>(m_sum) / m_count) : 0.0; }
+
+  uint64_t percentile(const double) const;
+
+  size_t allocatedBytes() const { return m_counts.capacity() * sizeof(uint64_t); }
+
+  bool save(FILE* const) const;
+
+  bool load(FILE* const);
+
+private:
+  static uint32_t bucket(const uint64_t value)
+  {
+    if (value < (2 * HISTOGRAM_SUB_BUCKETS)) {
+      return static_cast<uint32_t>(value);
+    }
+    uint32_t shift = (63 - __builtin_clzll(value)) - HISTOGRAM_SUB_BITS;
+    return (shift * HISTOGRAM_SUB_BUCKETS) + static_cast<uint32_t>(value >> shift);
+  }
+
+  static uint64_t highestValue(const uint32_t);
+
+private:
+  std::vector<uint64_t> m_counts;
+
+  uint64_t m_count;
+  uint64_t m_sum;
+  uint64_t m_max;
+};
+
+#endif /* HISTOGRAM_HPP */
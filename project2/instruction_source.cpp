@@ -0,0 +1,288 @@
+#include "instruction_source.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+
+/**
+ * @brief Function which skips over instructions, by reading them one by one.
+ *
+ * @param count   Number of instructions to be skipped.
+ *
+ * @return  Number of instructions actually skipped.
+ */
+uint64_t
+InstructionSource::skip(
+  const uint64_t count
+)
+{
+  proc_inst_t skipped;
+  uint64_t i = 0;
+  for (; (i < count) && next(&skipped); ++i);
+  return i;
+}
+
+/**
+ * @brief Constructor for a source which reads a text trace.
+ *
+ * @param file  File from which the trace is read, not closed by the source.
+ */
+FileSource::FileSource(
+  FILE* const file
+) : m_file(file)
+{
+}
+
+/**
+ * @brief Function which reads the next instruction of the text trace.
+ *
+ * @param p_inst  Pointer to the instruction to populate.
+ *
+ * @return  true if an instruction was read successfully.
+ */
+bool
+FileSource::next(
+  proc_inst_t* const p_inst
+)
+{
+  int ret = fscanf(m_file, "%x %d %d %d %d\n", &p_inst->instruction_address,
+                   &p_inst->op_code, &p_inst->dest_reg, &p_inst->src_reg[0], &p_inst->src_reg[1]);
+  return (ret == 5);
+}
+
+/**
+ * @brief Constructor for a source which reads binary trace records.
+ *
+ * @param begin   Pointer to the first record.
+ * @param end     Pointer past the last record.
+ */
+RecordSource::RecordSource(
+  const trace_record_t* const begin,
+  const trace_record_t* const end
+) : m_cursor(begin),
+  m_end(end)
+{
+}
+
+/**
+ * @brief Function which reads the next record.
+ *
+ * @param p_inst  Pointer to the instruction to populate.
+ *
+ * @return  true if there was a record left.
+ */
+bool
+RecordSource::next(
+  proc_inst_t* const p_inst
+)
+{
+  if (m_cursor == m_end) {
+    return false;
+  }
+  p_inst->instruction_address = m_cursor->instruction_address;
+  p_inst->op_code = m_cursor->op_code;
+  p_inst->src_reg[0] = m_cursor->src_reg[0];
+  p_inst->src_reg[1] = m_cursor->src_reg[1];
+  p_inst->dest_reg = m_cursor->dest_reg;
+  ++m_cursor;
+  return true;
+}
+
+/**
+ * @brief Function which skips over records without reading them.
+ *
+ * @param count   Number of records to be skipped.
+ *
+ * @return  Number of records actually skipped.
+ */
+uint64_t
+RecordSource::skip(
+  const uint64_t count
+)
+{
+  uint64_t skipped = std::min(count, static_cast<uint64_t>(m_end - m_cursor));
+  m_cursor += skipped;
+  return skipped;
+}
+
+/**
+ * @brief Constructor for a source which decompresses a block compressed trace.
+ *
+ * @param trace     Trace, which has to outlive the source.
+ * @param threads   Number of blocks decompressed at a time, one per thread.
+ */
+BlockSource::BlockSource(
+  const BlockTrace& trace,
+  const unsigned threads
+) : m_trace(trace),
+  m_threads(std::max(threads, 1u)),
+  m_records(),
+  m_base(0),
+  m_index(0),
+  m_failed(false)
+{
+}
+
+/**
+ * @brief Function which decompresses the blocks starting with the one of the
+ *        given instruction, and positions the source on that instruction. A
+ *        corrupt block is reported once, and nothing is read after it.
+ *
+ * @param instruction   Number of the instruction to be read next.
+ *
+ * @return  true if the blocks were valid.
+ */
+bool
+BlockSource::load(
+  const uint64_t instruction
+)
+{
+  if (m_failed) {
+    return false;
+  }
+  uint64_t block = instruction / m_trace.blockRecords();
+  m_base = block * m_trace.blockRecords();
+  m_index = static_cast<size_t>(instruction - m_base);
+  if (!m_trace.decode(block, m_threads, m_records, m_threads)) {
+    fprintf(stderr, "Corrupt block trace at instruction %" PRIu64 "\n", m_base);
+    m_records.clear();
+    m_failed = true;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Function which reads the next instruction, decompressing the next
+ *        blocks when the ones decompressed last are used up.
+ *
+ * @param p_inst  Pointer to the instruction to populate.
+ *
+ * @return  true if there was an instruction left.
+ */
+bool
+BlockSource::next(
+  proc_inst_t* const p_inst
+)
+{
+  if ((m_index >= m_records.size()) &&
+      (m_failed || ((m_base + m_records.size()) >= m_trace.size()) || !load(m_base + m_records.size()))) {
+    return false;
+  }
+  const trace_record_t& record = m_records[m_index++];
+  p_inst->instruction_address = record.instruction_address;
+  p_inst->op_code = record.op_code;
+  p_inst->src_reg[0] = record.src_reg[0];
+  p_inst->src_reg[1] = record.src_reg[1];
+  p_inst->dest_reg = record.dest_reg;
+  return true;
+}
+
+/**
+ * @brief Function which skips over instructions, without decompressing the
+ *        blocks in between.
+ *
+ * @param count   Number of instructions to be skipped.
+ *
+ * @return  Number of instructions actually skipped, 0 if the block of the
+ *          next instruction is corrupt.
+ */
+uint64_t
+BlockSource::skip(
+  const uint64_t count
+)
+{
+  uint64_t position = m_base + m_index;
+  uint64_t skipped = std::min(count, m_trace.size() - std::min(position, m_trace.size()));
+  if ((m_index + skipped) < m_records.size()) {
+    m_index += skipped;
+  }
+  else if ((position + skipped) < m_trace.size()) {
+    if (!load(position + skipped)) {
+      return 0;
+    }
+  }
+  else {
+    // past the end, the next read fails
+    m_base = m_trace.size();
+    m_index = 0;
+    m_records.clear();
+  }
+  return skipped;
+}
+
+/**
+ * @brief Constructor for a source which reads instructions from a vector.
+ *
+ * @param instructions  Instructions, which have to outlive the source.
+ */
+VectorSource::VectorSource(
+  const std::vector<proc_inst_t>& instructions
+) : m_instructions(instructions),
+  m_index(0)
+{
+}
+
+/**
+ * @brief Function which reads the next instruction from the vector.
+ *
+ * @param p_inst  Pointer to the instruction to populate.
+ *
+ * @return  true if there was an instruction left.
+ */
+bool
+VectorSource::next(
+  proc_inst_t* const p_inst
+)
+{
+  if (m_index == m_instructions.size()) {
+    return false;
+  }
+  *p_inst = m_instructions[m_index++];
+  return true;
+}
+
+/**
+ * @brief Function which skips over instructions without reading them.
+ *
+ * @param count   Number of instructions to be skipped.
+ *
+ * @return  Number of instructions actually skipped.
+ */
+uint64_t
+VectorSource::skip(
+  const uint64_t count
+)
+{
+  uint64_t skipped = std::min(count, static_cast<uint64_t>(m_instructions.size() - m_index));
+  m_index += skipped;
+  return skipped;
+}
+
+/**
+ * @brief Constructor for a source which asks a callback for instructions.
+ *
+ * @param callback  Function called for every instruction.
+ * @param context   Pointer passed to every call of the callback.
+ */
+CallbackSource::CallbackSource(
+  const callback_t callback,
+  void* const context
+) : m_callback(callback),
+  m_context(context)
+{
+}
+
+/**
+ * @brief Function which asks the callback for the next instruction.
+ *
+ * @param p_inst  Pointer to the instruction to populate.
+ *
+ * @return  true if the callback returned an instruction.
+ */
+bool
+CallbackSource::next(
+  proc_inst_t* const p_inst
+)
+{
+  return m_callback(p_inst, m_context);
+}
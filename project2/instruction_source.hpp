@@ -0,0 +1,116 @@
+#ifndef INSTRUCTION_SOURCE_HPP
+#define INSTRUCTION_SOURCE_HPP
+
+#include "block_trace.hpp"
+#include "procsim.hpp"
+
+#include <cstdio>
+#include <vector>
+
+/**
+ * @brief Interface for anything the simulator can fetch instructions from.
+ */
+class InstructionSource {
+public:
+  virtual ~InstructionSource() { }
+
+  virtual bool next(proc_inst_t* const) = 0;
+
+  virtual uint64_t skip(const uint64_t);
+};
+
+/**
+ * @brief Source which parses a text trace from a file, one instruction per line.
+ */
+class FileSource : public InstructionSource {
+public:
+  FileSource(FILE* const);
+
+  bool next(proc_inst_t* const);
+
+private:
+  FILE* m_file;
+};
+
+/**
+ * @brief Source which reads binary trace records from memory, for example
+ *        from a memory mapped trace or a TraceBuffer.
+ */
+class RecordSource : public InstructionSource {
+public:
+  RecordSource(const trace_record_t* const, const trace_record_t* const);
+
+  bool next(proc_inst_t* const);
+
+  uint64_t skip(const uint64_t);
+
+private:
+  const trace_record_t* m_cursor;
+  const trace_record_t* m_end;
+};
+
+/**
+ * @brief Source which decompresses a block compressed trace, several blocks at
+ *        a time on several threads. Skipping seeks straight to the block of
+ *        the instruction through the index of the trace.
+ */
+class BlockSource : public InstructionSource {
+public:
+  BlockSource(const BlockTrace&, const unsigned);
+
+  bool next(proc_inst_t* const);
+
+  uint64_t skip(const uint64_t);
+
+  // set once a corrupt block was found, the source then stays at its end
+  bool failed() const { return m_failed; }
+
+private:
+  bool load(const uint64_t);
+
+private:
+  const BlockTrace& m_trace;
+  unsigned m_threads;
+
+  // records of the blocks decompressed last, starting at instruction m_base
+  std::vector<trace_record_t> m_records;
+  uint64_t m_base;
+  size_t m_index;
+  bool m_failed;
+};
+
+/**
+ * @brief Source which reads instructions from a vector owned by the caller.
+ */
+class VectorSource : public InstructionSource {
+public:
+  VectorSource(const std::vector<proc_inst_t>&);
+
+  bool next(proc_inst_t* const);
+
+  uint64_t skip(const uint64_t);
+
+private:
+  const std::vector<proc_inst_t>& m_instructions;
+  size_t m_index;
+};
+
+/**
+ * @brief Source which asks a callback for every instruction, for example a
+ *        generator or another simulator. The callback returns false at the
+ *        end of the instructions.
+ */
+class CallbackSource : public InstructionSource {
+public:
+  typedef bool (*callback_t)(proc_inst_t* const, void* const);
+
+  CallbackSource(const callback_t, void* const);
+
+  bool next(proc_inst_t* const);
+
+private:
+  callback_t m_callback;
+  void* m_context;
+};
+
+#endif /* INSTRUCTION_SOURCE_HPP */
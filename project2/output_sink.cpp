@@ -0,0 +1,350 @@
+#include "output_sink.hpp"
+
+#include <cstring>
+
+/**
+ * @brief Constructor for a writer to the given file, which starts the writer thread.
+ *
+ * @param file  File to write to, which is flushed but not closed by the writer.
+ */
+AsyncWriter::AsyncWriter(
+  FILE* const file
+) : m_file(file),
+  m_buffers(OUTPUT_BUFFERS, std::vector<char>(OUTPUT_BUFFER_SIZE)),
+  m_sizes(OUTPUT_BUFFERS, 0),
+  m_current(0),
+  m_used(0),
+  m_pending(),
+  m_free(),
+  m_mutex(),
+  m_condition(),
+  m_stop(false),
+  m_writer()
+{
+  for (size_t b = 1; b < OUTPUT_BUFFERS; ++b) {
+    m_free.push_back(b);
+  }
+  m_writer = std::thread(&AsyncWriter::write, this);
+}
+
+/**
+ * @brief Destructor, which writes out everything appended so far.
+ */
+AsyncWriter::~AsyncWriter(
+)
+{
+  close();
+}
+
+/**
+ * @brief Function which appends the decimal representation of a number.
+ *
+ * @param value   Number to be appended.
+ */
+void
+AsyncWriter::appendUnsigned(
+  uint64_t value
+)
+{
+  char digits[20];
+  size_t d = sizeof(digits);
+  do {
+    digits[--d] = static_cast<char>('0' + (value % 10));
+    value /= 10;
+  } while (value != 0);
+  append(digits + d, sizeof(digits) - d);
+}
+
+/**
+ * @brief Function which hands the current buffer over to the writer thread,
+ *        and continues with a free buffer, waiting for one if necessary.
+ */
+void
+AsyncWriter::submit(
+)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_sizes[m_current] = m_used;
+  m_pending.push_back(m_current);
+  m_condition.notify_all();
+  while (m_free.empty()) {
+    m_condition.wait(lock);
+  }
+  m_current = m_free.front();
+  m_free.pop_front();
+  m_used = 0;
+}
+
+/**
+ * @brief Function which runs on the writer thread and writes out the pending
+ *        buffers in order, until the writer is closed.
+ */
+void
+AsyncWriter::write(
+)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    while (m_pending.empty() && !m_stop) {
+      m_condition.wait(lock);
+    }
+    if (m_pending.empty()) {
+      break;
+    }
+    size_t b = m_pending.front();
+    m_pending.pop_front();
+    lock.unlock();
+    fwrite(&m_buffers[b][0], 1, m_sizes[b], m_file);
+    lock.lock();
+    m_free.push_back(b);
+    m_condition.notify_all();
+  }
+}
+
+/**
+ * @brief Function which writes out everything appended so far, stops the
+ *        writer thread and flushes the file. Nothing can be appended afterwards.
+ */
+void
+AsyncWriter::close(
+)
+{
+  if (!m_writer.joinable()) {
+    return;
+  }
+  if (m_used > 0) {
+    submit();
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+    m_condition.notify_all();
+  }
+  m_writer.join();
+  fflush(m_file);
+}
+
+/**
+ * @brief Function which writes the header of the cycle log.
+ */
+void
+TextSink::writeCycleHeader(
+)
+{
+  static const char header[] = "INST\tFETCH\tDISP\tSCHED\tEXEC\tSTATE\n";
+  m_writer.append(header, sizeof(header) - 1);
+}
+
+/**
+ * @brief Function which writes the cycle log of one instruction.
+ *
+ * @param inst    Number of the instruction.
+ * @param cycles  Cycles at which the instruction entered each stage.
+ */
+void
+TextSink::writeCycles(
+  const uint32_t inst,
+  const unsigned long* const cycles
+)
+{
+  m_writer.appendUnsigned(inst);
+  for (int s = 0; s < 5; ++s) {
+    m_writer.appendChar('\t');
+    m_writer.appendUnsigned(cycles[s]);
+  }
+  m_writer.appendChar('\n');
+}
+
+/**
+ * @brief Function which writes the header of the event log.
+ */
+void
+TextSink::writeEventHeader(
+)
+{
+  static const char header[] = "CYCLE\tOPERATION\tINSTRUCTION\n";
+  m_writer.append(header, sizeof(header) - 1);
+}
+
+/**
+ * @brief Function which writes one event of an instruction.
+ *
+ * @param cycle       Cycle in which the event happened.
+ * @param operation   Name of the event.
+ * @param inst        Number of the instruction.
+ */
+void
+TextSink::writeEvent(
+  const unsigned long cycle,
+  const char* const operation,
+  const uint32_t inst
+)
+{
+  m_writer.appendUnsigned(cycle);
+  m_writer.appendChar('\t');
+  m_writer.append(operation, strlen(operation));
+  m_writer.appendChar('\t');
+  m_writer.appendUnsigned(inst);
+  m_writer.appendChar('\n');
+}
+
+/**
+ * @brief Function which ends the log with an empty line.
+ */
+void
+TextSink::writeEnd(
+)
+{
+  m_writer.appendChar('\n');
+}
+
+/**
+ * @brief Function which writes the header of the cycle log.
+ */
+void
+CsvSink::writeCycleHeader(
+)
+{
+  static const char header[] = "inst,fetch,disp,sched,exec,state\n";
+  m_writer.append(header, sizeof(header) - 1);
+}
+
+/**
+ * @brief Function which writes the cycle log of one instruction.
+ *
+ * @param inst    Number of the instruction.
+ * @param cycles  Cycles at which the instruction entered each stage.
+ */
+void
+CsvSink::writeCycles(
+  const uint32_t inst,
+  const unsigned long* const cycles
+)
+{
+  m_writer.appendUnsigned(inst);
+  for (int s = 0; s < 5; ++s) {
+    m_writer.appendChar(',');
+    m_writer.appendUnsigned(cycles[s]);
+  }
+  m_writer.appendChar('\n');
+}
+
+/**
+ * @brief Function which writes the header of the event log.
+ */
+void
+CsvSink::writeEventHeader(
+)
+{
+  static const char header[] = "cycle,operation,instruction\n";
+  m_writer.append(header, sizeof(header) - 1);
+}
+
+/**
+ * @brief Function which writes one event of an instruction.
+ *
+ * @param cycle       Cycle in which the event happened.
+ * @param operation   Name of the event.
+ * @param inst        Number of the instruction.
+ */
+void
+CsvSink::writeEvent(
+  const unsigned long cycle,
+  const char* const operation,
+  const uint32_t inst
+)
+{
+  m_writer.appendUnsigned(cycle);
+  m_writer.appendChar(',');
+  m_writer.append(operation, strlen(operation));
+  m_writer.appendChar(',');
+  m_writer.appendUnsigned(inst);
+  m_writer.appendChar('\n');
+}
+
+/**
+ * @brief Constructor for a binary sink, which starts with the magic and the
+ *        version of the format.
+ *
+ * @param file  File to write to.
+ */
+BinarySink::BinarySink(
+  FILE* const file
+) : m_writer(file)
+{
+  char magic[OUTPUT_LOG_MAGIC_SIZE];
+  memcpy(magic, OUTPUT_LOG_MAGIC, OUTPUT_LOG_MAGIC_SIZE);
+  m_writer.append(magic, OUTPUT_LOG_MAGIC_SIZE);
+  m_writer.appendValue(static_cast<uint32_t>(OUTPUT_LOG_VERSION));
+}
+
+/**
+ * @brief Function which writes the cycle log of one instruction.
+ *
+ * @param inst    Number of the instruction.
+ * @param cycles  Cycles at which the instruction entered each stage.
+ */
+void
+BinarySink::writeCycles(
+  const uint32_t inst,
+  const unsigned long* const cycles
+)
+{
+  m_writer.appendChar('C');
+  m_writer.appendValue(inst);
+  m_writer.appendValue(static_cast<uint64_t>(cycles[0]));
+  for (int s = 1; s < 5; ++s) {
+    m_writer.appendValue(static_cast<uint32_t>(cycles[s] - cycles[0]));
+  }
+}
+
+/**
+ * @brief Function which writes one event of an instruction.
+ *
+ * @param cycle       Cycle in which the event happened.
+ * @param operation   Name of the event.
+ * @param inst        Number of the instruction.
+ */
+void
+BinarySink::writeEvent(
+  const unsigned long cycle,
+  const char* const operation,
+  const uint32_t inst
+)
+{
+  uint8_t length = static_cast<uint8_t>(std::min(strlen(operation), static_cast<size_t>(UINT8_MAX)));
+  m_writer.appendChar('E');
+  m_writer.appendValue(static_cast<uint64_t>(cycle));
+  m_writer.appendValue(inst);
+  m_writer.appendValue(length);
+  m_writer.append(operation, length);
+}
+
+/**
+ * @brief Function which creates a sink of the given format.
+ *
+ * @param format  One of text, csv, binary or null.
+ * @param file    File to write to, not used by the null sink.
+ *
+ * @return  The sink, owned by the caller, or NULL for an unknown format.
+ */
+OutputSink*
+create_output_sink(
+  const char* const format,
+  FILE* const file
+)
+{
+  if (strcmp(format, "text") == 0) {
+    return new TextSink(file);
+  }
+  if (strcmp(format, "csv") == 0) {
+    return new CsvSink(file);
+  }
+  if (strcmp(format, "binary") == 0) {
+    return new BinarySink(file);
+  }
+  if (strcmp(format, "null") == 0) {
+    return new OutputSink();
+  }
+  return NULL;
+}
@@ -0,0 +1,172 @@
+#ifndef OUTPUT_SINK_HPP
+#define OUTPUT_SINK_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// size and number of the buffers which are filled while earlier ones are written out
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+#define OUTPUT_BUFFERS 4
+
+#define OUTPUT_LOG_MAGIC "PSIMLOG"
+#define OUTPUT_LOG_MAGIC_SIZE 8
+#define OUTPUT_LOG_VERSION 1
+
+/**
+ * @brief Writer which collects output in large buffers, and writes the filled
+ *        buffers to a file on a background thread. The caller only waits when
+ *        all the buffers are waiting to be written.
+ */
+class AsyncWriter {
+public:
+  AsyncWriter(FILE* const);
+
+  ~AsyncWriter();
+
+  void append(const char* const data, const size_t size)
+  {
+    if ((m_used + size) > OUTPUT_BUFFER_SIZE) {
+      submit();
+    }
+    std::copy(data, data + size, m_buffers[m_current].begin() + m_used);
+    m_used += size;
+  }
+
+  void appendChar(const char c)
+  {
+    if (m_used == OUTPUT_BUFFER_SIZE) {
+      submit();
+    }
+    m_buffers[m_current][m_used++] = c;
+  }
+
+  void appendUnsigned(uint64_t);
+
+  template <typename T>
+  void appendValue(const T& value) { append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+  void close();
+
+private:
+  // the writer thread works on the instance, so it can not be copied
+  AsyncWriter(const AsyncWriter&);
+
+  AsyncWriter& operator=(const AsyncWriter&);
+
+  void submit();
+
+  void write();
+
+private:
+  FILE* m_file;
+
+  std::vector<std::vector<char> > m_buffers;
+  std::vector<size_t> m_sizes;
+
+  // buffer being filled by the caller, and the number of bytes in it
+  size_t m_current;
+  size_t m_used;
+
+  // buffers waiting to be written, in order, and buffers which can be filled
+  std::deque<size_t> m_pending;
+  std::deque<size_t> m_free;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_stop;
+
+  std::thread m_writer;
+};
+
+/**
+ * @brief Interface for the destinations of the cycle log, and of the events
+ *        printed by the simulator when DEBUG_LOG is set. The default
+ *        implementation discards everything.
+ */
+class OutputSink {
+public:
+  virtual ~OutputSink() { }
+
+  virtual void writeCycleHeader() { }
+
+  virtual void writeCycles(const uint32_t, const unsigned long* const) { }
+
+  virtual void writeEventHeader() { }
+
+  virtual void writeEvent(const unsigned long, const char* const, const uint32_t) { }
+
+  virtual void writeEnd() { }
+
+  virtual void close() { }
+};
+
+/**
+ * @brief Sink which writes tab separated text, in the format of the original cycle log.
+ */
+class TextSink : public OutputSink {
+public:
+  TextSink(FILE* const file) : m_writer(file) { }
+
+  void writeCycleHeader();
+
+  void writeCycles(const uint32_t, const unsigned long* const);
+
+  void writeEventHeader();
+
+  void writeEvent(const unsigned long, const char* const, const uint32_t);
+
+  void writeEnd();
+
+  void close() { m_writer.close(); }
+
+protected:
+  AsyncWriter m_writer;
+};
+
+/**
+ * @brief Sink which writes comma separated values, with a header line.
+ */
+class CsvSink : public TextSink {
+public:
+  CsvSink(FILE* const file) : TextSink(file) { }
+
+  void writeCycleHeader();
+
+  void writeCycles(const uint32_t, const unsigned long* const);
+
+  void writeEventHeader();
+
+  void writeEvent(const unsigned long, const char* const, const uint32_t);
+
+  void writeEnd() { }
+};
+
+/**
+ * @brief Sink which writes compact binary records, each starting with a type
+ *        byte. A cycle log record ('C') holds the instruction and its fetch
+ *        cycle, followed by the other stage cycles as offsets from the fetch
+ *        cycle. An event record ('E') holds the cycle, the instruction and
+ *        the length prefixed name of the event.
+ */
+class BinarySink : public OutputSink {
+public:
+  BinarySink(FILE* const);
+
+  void writeCycles(const uint32_t, const unsigned long* const);
+
+  void writeEvent(const unsigned long, const char* const, const uint32_t);
+
+  void close() { m_writer.close(); }
+
+private:
+  AsyncWriter m_writer;
+};
+
+OutputSink* create_output_sink(const char* const, FILE* const);
+
+#endif /* OUTPUT_SINK_HPP */
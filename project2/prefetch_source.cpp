@@ -0,0 +1,118 @@
+#include "prefetch_source.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Constructor for a source which starts reading the given source on a
+ *        reader thread right away.
+ *
+ * @param source      Source to be read ahead, which has to outlive this source.
+ * @param depth       Maximum number of batches read ahead.
+ * @param batchSize   Number of instructions in a batch.
+ */
+PrefetchSource::PrefetchSource(
+  InstructionSource* const source,
+  const size_t depth,
+  const size_t batchSize
+) : m_source(source),
+  m_batches(std::max(depth, static_cast<size_t>(1))),
+  m_batchSize(std::max(batchSize, static_cast<size_t>(1))),
+  m_head(0),
+  m_tail(0),
+  m_stop(false),
+  m_acquired(false),
+  m_index(0),
+  m_done(false),
+  m_reader()
+{
+  for (std::vector<prefetch_batch_t>::iterator b = m_batches.begin(); b != m_batches.end(); ++b) {
+    b->instructions.resize(m_batchSize);
+    b->size = 0;
+    b->last = false;
+  }
+  m_reader = std::thread(&PrefetchSource::read, this);
+}
+
+/**
+ * @brief Destructor, which stops the reader thread if it has not reached the
+ *        end of the source yet.
+ */
+PrefetchSource::~PrefetchSource(
+)
+{
+  m_stop.store(true, std::memory_order_relaxed);
+  m_reader.join();
+}
+
+/**
+ * @brief Function which runs on the reader thread and fills the batches of the
+ *        ring, waiting whenever the ring is full.
+ */
+void
+PrefetchSource::read(
+)
+{
+  const uint64_t depth = m_batches.size();
+  uint64_t tail = 0;
+  bool last = false;
+  while (!last) {
+    // wait for the simulator to release a batch
+    while ((tail - m_head.load(std::memory_order_acquire)) == depth) {
+      if (m_stop.load(std::memory_order_relaxed)) {
+        return;
+      }
+      std::this_thread::yield();
+    }
+    if (m_stop.load(std::memory_order_relaxed)) {
+      return;
+    }
+    prefetch_batch_t& batch = m_batches[tail % depth];
+    batch.size = 0;
+    while ((batch.size < m_batchSize) && m_source->next(&batch.instructions[batch.size])) {
+      ++batch.size;
+    }
+    last = (batch.size < m_batchSize);
+    batch.last = last;
+    // publish the batch to the simulator
+    m_tail.store(++tail, std::memory_order_release);
+  }
+}
+
+/**
+ * @brief Function which reads the next instruction from the batch at the head
+ *        of the ring, waiting for the reader thread if the ring is empty.
+ *
+ * @param p_inst  Pointer to the instruction to populate.
+ *
+ * @return  true if an instruction was read, false at the end of the source.
+ */
+bool
+PrefetchSource::next(
+  proc_inst_t* const p_inst
+)
+{
+  const uint64_t depth = m_batches.size();
+  while (!m_done) {
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    if (!m_acquired) {
+      while (m_tail.load(std::memory_order_acquire) == head) {
+        std::this_thread::yield();
+      }
+      m_acquired = true;
+      m_index = 0;
+    }
+    const prefetch_batch_t& batch = m_batches[head % depth];
+    if (m_index < batch.size) {
+      *p_inst = batch.instructions[m_index++];
+      return true;
+    }
+    if (batch.last) {
+      m_done = true;
+      break;
+    }
+    // hand the batch back to the reader
+    m_acquired = false;
+    m_head.store(head + 1, std::memory_order_release);
+  }
+  return false;
+}
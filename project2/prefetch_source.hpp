@@ -0,0 +1,68 @@
+#ifndef PREFETCH_SOURCE_HPP
+#define PREFETCH_SOURCE_HPP
+
+#include "instruction_source.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// number of instructions handed over from the reader thread at a time
+#define PREFETCH_BATCH_SIZE 4096
+
+/**
+ * @brief Source which reads another source ahead of the simulator on a reader
+ *        thread, so that parsing overlaps with simulation. Instructions are
+ *        passed in batches through a lock-free single producer, single
+ *        consumer ring, which bounds the number of instructions read ahead.
+ */
+class PrefetchSource : public InstructionSource {
+public:
+  PrefetchSource(InstructionSource* const, const size_t, const size_t = PREFETCH_BATCH_SIZE);
+
+  ~PrefetchSource();
+
+  bool next(proc_inst_t* const);
+
+private:
+  // the reader thread works on the instance, so it can not be copied
+  PrefetchSource(const PrefetchSource&);
+
+  PrefetchSource& operator=(const PrefetchSource&);
+
+  void read();
+
+private:
+  /**
+   * @brief Struct for storing one slot of the ring
+   */
+  typedef struct _prefetch_batch_t {
+    std::vector<proc_inst_t> instructions;
+    size_t size;
+    // set for the batch with the last instructions of the source
+    bool last;
+  } prefetch_batch_t;
+
+  InstructionSource* m_source;
+  std::vector<prefetch_batch_t> m_batches;
+  size_t m_batchSize;
+
+  // the indices written by the two threads are kept on separate cache lines
+  char m_headPadding[64];
+  // number of batches released by the simulator, written only by the simulator thread
+  std::atomic<uint64_t> m_head;
+  char m_tailPadding[64];
+  // number of batches filled by the reader, written only by the reader thread
+  std::atomic<uint64_t> m_tail;
+  std::atomic<bool> m_stop;
+  char m_consumerPadding[64];
+
+  // position of the simulator in the batch at the head of the ring
+  bool m_acquired;
+  size_t m_index;
+  bool m_done;
+
+  std::thread m_reader;
+};
+
+#endif /* PREFETCH_SOURCE_HPP */
@@ -0,0 +1,86 @@
+#include "processor.hpp"
+
+#include <cstring>
+
+/**
+ * @brief Constructor for a processor with the given configuration. The cycle
+ *        log is disabled, it can be enabled using setCycleLogSink(). The sink
+ *        is not owned by the processor and writes asynchronously, so it has to
+ *        outlive the processor, unless finishCycleLog() is called first. That
+ *        call returns once every row of the log is in the file of the sink.
+ *
+ * @param r   Number of result buses to be used.
+ * @param k   Array which specifies number of functional units, of each type, to be used.
+ * @param f   Number of instructions to fetch in each cycle.
+ */
+Processor::Processor(
+  const uint64_t r,
+  const uint64_t k[NUM_FU_TYPES],
+  const uint64_t f
+) : m_simulator(r, k, f)
+{
+  memset(&m_stats, 0, sizeof(proc_stats_t));
+}
+
+/**
+ * @brief Function which simulates the given number of cycles, or fewer if all
+ *        the instructions have executed before that.
+ *
+ * @param cycles  Number of cycles to be simulated.
+ *
+ * @return  Number of cycles which were simulated.
+ */
+uint64_t
+Processor::step(
+  const uint64_t cycles
+)
+{
+  uint64_t c = 0;
+  for (; (c < cycles) && !m_simulator.done(); ++c) {
+    m_simulator.cycle(&m_stats);
+  }
+  return c;
+}
+
+/**
+ * @brief Function which simulates until the given number of instructions
+ *        have retired, in total, or all the instructions have executed.
+ *
+ * @param instructions  Number of retired instructions at which to stop.
+ *
+ * @return  true if the number of instructions was reached.
+ */
+bool
+Processor::runUntil(
+  const uint64_t instructions
+)
+{
+  while (!m_simulator.done() && (m_simulator.retiredInstruction() < instructions)) {
+    m_simulator.cycle(&m_stats);
+  }
+  return (m_simulator.retiredInstruction() >= instructions);
+}
+
+/**
+ * @brief Function which simulates until all the instructions have executed.
+ */
+void
+Processor::run(
+)
+{
+  m_simulator.simulateProcessor(&m_stats);
+}
+
+/**
+ * @brief Function which returns the statistics collected so far, with the
+ *        averages computed up to the current cycle.
+ */
+const proc_stats_t&
+Processor::statistics(
+)
+{
+  if (m_stats.cycle_count > 0) {
+    m_simulator.computeStatistics(&m_stats);
+  }
+  return m_stats;
+}
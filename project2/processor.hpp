@@ -0,0 +1,68 @@
+#ifndef PROCESSOR_HPP
+#define PROCESSOR_HPP
+
+#include "instruction_source.hpp"
+#include "tomasulo.hpp"
+
+/**
+ * @brief Self-contained processor, owning its simulator and statistics, so any
+ *        number of them can be simulated in one process. This is the interface
+ *        of libprocsim.
+ */
+class Processor {
+public:
+  Processor(const uint64_t, const uint64_t[NUM_FU_TYPES], const uint64_t);
+
+  void setSource(InstructionSource* const source) { m_simulator.setSource(source); }
+
+  void setTrace(const trace_record_t* const begin, const trace_record_t* const end) { m_simulator.setTrace(begin, end); }
+
+  bool setDispatch(const uint64_t capacity, const uint64_t width) { return m_simulator.setDispatch(capacity, width); }
+
+  bool setThreads(const uint32_t numThreads, const fetch_policy_t policy) { return m_simulator.setThreads(numThreads, policy); }
+
+  void setThreadSource(const uint32_t thread, InstructionSource* const source) { m_simulator.setThreadSource(thread, source); }
+
+  void setThreadTrace(const uint32_t thread, const trace_record_t* const begin, const trace_record_t* const end) { m_simulator.setThreadTrace(thread, begin, end); }
+
+  void setFUTiming(const uint64_t latency[NUM_FU_TYPES], const uint64_t interval[NUM_FU_TYPES]) { m_simulator.setFUTiming(latency, interval); }
+
+  void setSelectPolicy(const select_policy_t issuePolicy, const select_policy_t busPolicy) { m_simulator.setSelectPolicy(issuePolicy, busPolicy); }
+
+  void setCycleLogSink(OutputSink* const sink) { m_simulator.setCycleLogSink(sink); }
+
+  void finishCycleLog() { m_simulator.finishCycleLog(); }
+
+  void enableHistograms() { m_simulator.enableHistograms(); }
+
+  void printHistograms(std::ostream& stream) const { m_simulator.printHistograms(stream); }
+
+  uint64_t step(const uint64_t);
+
+  bool runUntil(const uint64_t);
+
+  void run();
+
+  bool runUntilConverged(const convergence_params_t& params, convergence_t* const p_result) { return m_simulator.simulateUntilConverged(&m_stats, params, p_result); }
+
+  bool done() const { return m_simulator.done(); }
+
+  unsigned long cycles() const { return m_stats.cycle_count; }
+
+  unsigned long retiredInstruction() const { return m_simulator.retiredInstruction(); }
+
+  size_t allocatedBytes() const { return m_simulator.allocatedBytes(); }
+
+  const proc_stats_t& statistics();
+
+  bool saveCheckpoint(FILE* const f) const { return m_simulator.saveCheckpoint(f, &m_stats); }
+
+  bool loadCheckpoint(FILE* const f) { return m_simulator.loadCheckpoint(f, &m_stats); }
+
+private:
+  TomasuloSimulator m_simulator;
+
+  proc_stats_t m_stats;
+};
+
+#endif /* PROCESSOR_HPP */
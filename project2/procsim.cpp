@@ -3,10 +3,16 @@
 #include "tomasulo.hpp"
 
 #include <cinttypes>
+#include <iostream>
+#include <memory>
 
 // Object of Tomasulo Simulator class.
 TomasuloSimulator ts;
 
+// Sinks for the cycle log and, with DEBUG_LOG, the events of the processor.
+std::unique_ptr<OutputSink> cycleLogSink;
+std::unique_ptr<OutputSink> debugSink;
+
 /**
  * Subroutine for initializing the processor. You many add and initialize any global or heap
  * variables as needed.
@@ -21,6 +27,136 @@ void setup_proc(uint64_t r, uint64_t k0, uint64_t k1, uint64_t k2, uint64_t f)
 {
   uint64_t k[] = {k0, k1, k2};
   ts = TomasuloSimulator(r, k, f);
+  // the cycle log is written as text to stdout, unless chosen otherwise
+  cycleLogSink.reset(new TextSink(stdout));
+  ts.setCycleLogSink(cycleLogSink.get());
+#if DEBUG_LOG
+  debugSink.reset(new TextSink(stderr));
+  ts.setDebugSink(debugSink.get());
+#endif
+}
+
+/**
+ * Subroutine for setting the latency and the initiation interval of the FUs,
+ * every type of FUs executes in one cycle and is not pipelined by default.
+ *
+ * @latency Latency of k0, k1 and k2 FUs
+ * @interval Initiation interval of k0, k1 and k2 FUs
+ */
+void setup_fu_timing(const uint64_t latency[3], const uint64_t interval[3])
+{
+  ts.setFUTiming(latency, interval);
+}
+
+/**
+ * Subroutine for choosing which ready instructions fire on the free FUs, and
+ * which results are broadcast on the result buses. Both pick the oldest first
+ * by default.
+ *
+ * @issuePolicy Policy for firing, one of oldest, longest-chain, most-dependents or random
+ * @busPolicy Policy for the result buses, with the same choices
+ *
+ * Returns false if a policy is unknown
+ */
+bool setup_select_policy(const char* issuePolicy, const char* busPolicy)
+{
+  select_policy_t issue, bus;
+  if (!parse_select_policy(issuePolicy, &issue) || !parse_select_policy(busPolicy, &bus)) {
+    return false;
+  }
+  ts.setSelectPolicy(issue, bus);
+  return true;
+}
+
+/**
+ * Subroutine for bounding the dispatch queue, fetch stalls while it is full,
+ * and the number of instructions dispatched in a cycle. Both are unlimited by default.
+ *
+ * @queueCapacity Capacity of the dispatch queue of every thread, or 0 for no limit
+ * @width Number of instructions dispatched in a cycle, or 0 for no limit
+ *
+ * Returns false if instructions have already been fetched
+ */
+bool setup_dispatch(uint64_t queueCapacity, uint64_t width)
+{
+  return ts.setDispatch(queueCapacity, width);
+}
+
+/**
+ * Subroutine for choosing what is reported about every instruction. The cycle
+ * log of every instruction is written by default, histograms of the latencies
+ * and the queue occupancies take fixed memory however long the trace is.
+ *
+ * @format Format of the cycle log, one of text, csv, binary or null
+ * @file File to which the cycle log is written
+ * @histograms Keep histograms and print them when the processor completes
+ */
+bool setup_logging(const char* format, FILE* file, bool histograms)
+{
+  OutputSink* sink = create_output_sink(format, file);
+  if (sink == NULL) {
+    return false;
+  }
+  cycleLogSink.reset(sink);
+  ts.setCycleLogSink(sink);
+  if (histograms) {
+    ts.enableHistograms();
+  }
+  return true;
+}
+
+/**
+ * Subroutine for making the processor fetch from a memory mapped binary trace
+ * instead of reading every instruction from a source.
+ *
+ * @begin First record of the trace
+ * @end Record past the last record of the trace
+ */
+void setup_trace(const trace_record_t* begin, const trace_record_t* end)
+{
+  ts.setTrace(begin, end);
+}
+
+/**
+ * Subroutine for setting the source from which the processor fetches instructions.
+ * Instructions fetched before a restored checkpoint are skipped in the source.
+ *
+ * @source Source of the instructions
+ */
+void setup_source(InstructionSource* source)
+{
+  ts.setSource(source);
+}
+
+/**
+ * Subroutine for making several hardware threads share the processor, each with
+ * its own registers and dispatch queue. One thread fetches in every cycle. Has
+ * to be called before the threads are given their traces.
+ *
+ * @threads Number of threads, from 1 to MAX_SMT_THREADS
+ * @fetchPolicy Policy picking the thread which fetches, either round-robin or icount
+ *
+ * Returns false if the number of threads or the policy is not supported
+ */
+bool setup_smt(unsigned threads, const char* fetchPolicy)
+{
+  fetch_policy_t policy;
+  if (!parse_fetch_policy(fetchPolicy, &policy)) {
+    return false;
+  }
+  return ts.setThreads(threads, policy);
+}
+
+/**
+ * Subroutine for making one thread of the processor fetch from a memory mapped binary trace.
+ *
+ * @thread Index of the thread
+ * @begin First record of the trace
+ * @end Record past the last record of the trace
+ */
+void setup_thread_trace(unsigned thread, const trace_record_t* begin, const trace_record_t* end)
+{
+  ts.setThreadTrace(thread, begin, end);
 }
 
 /**
@@ -34,6 +170,85 @@ void run_proc(proc_stats_t* p_stats)
   ts.simulateProcessor(p_stats);
 }
 
+/**
+ * Subroutine that simulates the processor up to the given cycle, or until all
+ * instructions have executed if that happens earlier.
+ *
+ * @p_stats Pointer to the statistics structure
+ * @cycle Cycle after which the simulation stops
+ */
+void run_proc_until(proc_stats_t* p_stats, unsigned long cycle)
+{
+  while (!ts.done() && (p_stats->cycle_count < cycle)) {
+    ts.cycle(p_stats);
+  }
+}
+
+/**
+ * Subroutine that simulates the processor until its IPC has converged within
+ * the tolerance, the budget of instructions is spent, or all instructions have executed.
+ *
+ * @p_stats Pointer to the statistics structure
+ * @params Window, tolerance and budget of the run
+ * @p_result Pointer to the structure for the estimated IPC and its error
+ *
+ * Returns true if the simulation stopped before all instructions executed
+ */
+bool run_proc_converged(proc_stats_t* p_stats, const convergence_params_t* params, convergence_t* p_result)
+{
+  return ts.simulateUntilConverged(p_stats, *params, p_result);
+}
+
+/**
+ * Subroutine for writing the state of the processor to a checkpoint file.
+ *
+ * @fileName Name of the checkpoint file
+ * @p_stats Pointer to the statistics structure
+ */
+bool checkpoint_proc(const char* fileName, const proc_stats_t* p_stats)
+{
+  FILE* f = fopen(fileName, "wb");
+  if (f == NULL) {
+    return false;
+  }
+  bool written = ts.saveCheckpoint(f, p_stats);
+  return (fclose(f) == 0) && written;
+}
+
+/**
+ * Subroutine for restoring the state of the processor from a checkpoint file,
+ * the processor has to be set up with the same configuration first.
+ *
+ * @fileName Name of the checkpoint file
+ * @p_stats Pointer to the statistics structure
+ * @p_fetched Pointer to the number of instructions of the trace fetched before the checkpoint
+ */
+bool restore_proc(const char* fileName, proc_stats_t* p_stats, uint64_t* p_fetched)
+{
+  FILE* f = fopen(fileName, "rb");
+  if (f == NULL) {
+    return false;
+  }
+  bool restored = ts.loadCheckpoint(f, p_stats);
+  fclose(f);
+  *p_fetched = ts.fetchedInstruction();
+  return restored;
+}
+
+/**
+ * Subroutine for writing out everything the processor has logged so far, the
+ * logs are written on background threads until then.
+ */
+void close_proc_output()
+{
+  if (cycleLogSink) {
+    cycleLogSink->close();
+  }
+  if (debugSink) {
+    debugSink->close();
+  }
+}
+
 /**
  * Subroutine for cleaning up any outstanding instructions and calculating overall statistics
  * such as average IPC, average fire rate etc.
@@ -43,9 +258,7 @@ void run_proc(proc_stats_t* p_stats)
 void complete_proc(proc_stats_t *p_stats) 
 {
   ts.printInstructionCycles();
-  double cycle_count_double = static_cast<double>(p_stats->cycle_count);
-  p_stats->retired_instruction = ts.retiredInstruction();
-  p_stats->avg_inst_retired = ts.retiredInstruction() / cycle_count_double; 
-  p_stats->avg_inst_fired = ts.firedInstruction() / cycle_count_double; 
-  p_stats->avg_disp_size = ts.dispatchQueueSize() / cycle_count_double;
+  close_proc_output();
+  ts.printHistograms(std::cout);
+  ts.computeStatistics(p_stats);
 }
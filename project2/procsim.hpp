@@ -4,11 +4,16 @@
 #include <cstdint>
 #include <cstdio>
 
+#include "convergence.hpp"
+#include "trace.hpp"
+
 #define DEFAULT_K0 1
 #define DEFAULT_K1 2
 #define DEFAULT_K2 3
 #define DEFAULT_R 8
 #define DEFAULT_F 4
+// largest number of hardware threads sharing one core in SMT mode
+#define MAX_SMT_THREADS 8
 
 typedef struct _proc_inst_t
 {
@@ -19,6 +24,9 @@ typedef struct _proc_inst_t
     uint32_t tag;
     
     // You may introduce other fields as needed
+
+    // hardware thread which fetched the instruction
+    uint32_t thread;
     
 } proc_inst_t;
 
@@ -30,12 +38,54 @@ typedef struct _proc_stats_t
     unsigned long max_disp_size;
     unsigned long retired_instruction;
     unsigned long cycle_count;
+
+    // cycles spent by all the instructions from the start of execution to the broadcast of the result
+    unsigned long exec_cycles;
+
+    // issue slots (one per FU per cycle), split by what happened to them in each cycle
+    unsigned long slots_total;
+    unsigned long slots_fired;
+    unsigned long slots_sched_full;
+    unsigned long slots_no_fu;
+    unsigned long slots_result_bus;
+    unsigned long slots_operands;
+    unsigned long slots_frontend;
+    unsigned long slots_dispatch_width;
+
+    // instruction-cycles spent stalled, for each reason
+    unsigned long stall_sched_full;
+    unsigned long stall_no_fu;
+    unsigned long stall_operands;
+    unsigned long stall_result_bus;
+    unsigned long stall_dispatch_width;
+
+    // cycles in which fetch stopped early because the dispatch queue was full
+    unsigned long fetch_stall_cycles;
+
+    // number of hardware threads, the instructions retired by each of them and
+    // the cycle in which each of them retired its last instruction
+    unsigned long threads;
+    unsigned long thread_retired[MAX_SMT_THREADS];
+    unsigned long thread_cycles[MAX_SMT_THREADS];
 } proc_stats_t;
 
-bool read_instruction(proc_inst_t* p_inst);
+class InstructionSource;
 
 void setup_proc(uint64_t r, uint64_t k0, uint64_t k1, uint64_t k2, uint64_t f);
+void setup_fu_timing(const uint64_t latency[3], const uint64_t interval[3]);
+bool setup_select_policy(const char* issuePolicy, const char* busPolicy);
+bool setup_dispatch(uint64_t queueCapacity, uint64_t width);
+bool setup_logging(const char* format, FILE* file, bool histograms);
+void setup_trace(const trace_record_t* begin, const trace_record_t* end);
+void setup_source(InstructionSource* source);
+bool setup_smt(unsigned threads, const char* fetchPolicy);
+void setup_thread_trace(unsigned thread, const trace_record_t* begin, const trace_record_t* end);
 void run_proc(proc_stats_t* p_stats);
+void run_proc_until(proc_stats_t* p_stats, unsigned long cycle);
+bool run_proc_converged(proc_stats_t* p_stats, const convergence_params_t* params, convergence_t* p_result);
+bool checkpoint_proc(const char* fileName, const proc_stats_t* p_stats);
+bool restore_proc(const char* fileName, proc_stats_t* p_stats, uint64_t* p_fetched);
+void close_proc_output();
 void complete_proc(proc_stats_t* p_stats);
 
 #endif /* PROCSIM_HPP */
@@ -2,10 +2,24 @@
 #include <cinttypes>
 #include <cstdlib>
 #include <cstring>
+#include <getopt.h>
+#include <memory>
+#include <string>
+#include <thread>
 #include <unistd.h>
+#include <vector>
+#include "block_trace.hpp"
+#include "instruction_source.hpp"
+#include "prefetch_source.hpp"
 #include "procsim.hpp"
+#include "result_cache.hpp"
+#include "simpoint.hpp"
+#include "sweep.hpp"
+#include "tomasulo.hpp"
 
 FILE* inFile = stdin;
+BinaryTrace binaryTrace;
+BlockTrace blockTrace;
 
 void print_help_and_exit(void) {
     printf("procsim [OPTIONS]\n");
@@ -14,36 +28,97 @@ void print_help_and_exit(void) {
     printf("  -l k2\t\tNumber of k2 FUs\n");   
     printf("  -f N\t\tNumber of instructions to fetch\n");
     printf("  -r R\t\tNumber of result buses\n");
-    printf("  -i traces/file.trace\n");
+    printf("  -i traces/file.trace\tText, binary or block compressed trace (default: text on stdin)\n");
     printf("  -h\t\tThis helpful output\n");
+    printf("  --simpoints file.simpoints\tSimulate only the simulation points of the -i trace\n");
+    printf("  --warmup N\tInstructions simulated before every simulation point (default: one interval)\n");
+    printf("  --simpoint-error E\tSimulate points until the 95%% confidence interval of the IPC is within a fraction E of it (default: %g)\n", SIMPOINT_TARGET_ERROR);
+    printf("  --checkpoint-at N\tStop at cycle N and write the state of the processor to --checkpoint\n");
+    printf("  --checkpoint file.ckpt\tCheckpoint file to write\n");
+    printf("  --restore file.ckpt\tResume from a checkpoint written with the same settings and trace\n");
+    printf("  --latency L0,L1,L2\tLatency of k0, k1 and k2 FUs in cycles (default: 1,1,1)\n");
+    printf("  --ii I0,I1,I2\tInitiation interval of k0, k1 and k2 FUs in cycles (default: 1,1,1)\n");
+    printf("  --prefetch N\tRead up to N batches of %d instructions ahead on a reader thread\n", PREFETCH_BATCH_SIZE);
+    printf("  --histograms\tPrint histograms of the latencies and the queue occupancies\n");
+    printf("  --output FORMAT\tFormat of the cycle log: text, csv, binary or null (default: text)\n");
+    printf("  --output-file file\tFile to write the cycle log to (default: stdout)\n");
+    printf("  --no-cycle-log\tDo not write the cycle log, same as --output null\n");
+    printf("  --issue-policy P\tOrder in which ready instructions fire: oldest, longest-chain, most-dependents or random (default: oldest)\n");
+    printf("  --bus-policy P\tOrder in which results get a result bus, same choices (default: oldest)\n");
+    printf("  --cpi-stack\tPrint the CPI stack after the statistics\n");
+    printf("  --cpi-stack-json file.json\tWrite the CPI stack as JSON\n");
+    printf("  --converge T\tStop once the 95%% confidence interval of the IPC is within a fraction T of it. With\n");
+    printf("\t\t--sweep, rows end with a flag set to 1 for runs which stopped early: their IPC and cycles\n");
+    printf("\t\tare estimated for the whole trace, their dispatch queue sizes cover only the simulated part\n");
+    printf("  --window N\tInstructions in every window measured by --converge (default: %d)\n", DEFAULT_CONVERGENCE_WINDOW);
+    printf("  --budget N\tStop --converge after N instructions even if the IPC has not converged\n");
+    printf("  --dispatch-queue N\tCapacity of the dispatch queue, fetch stalls while it is full (default: unbounded)\n");
+    printf("  --dispatch-width N\tInstructions dispatched per cycle (default: as many as the scheduling queue takes)\n");
+    printf("  --smt A,B,...\tRun 2 to %d traces as hardware threads sharing the processor, instead of -i\n", MAX_SMT_THREADS);
+    printf("  --fetch-policy P\tThread fetching in each cycle with --smt: round-robin or icount (default: round-robin)\n");
+    printf("  --cache file\tReuse the statistics of an earlier run of the -i trace with the same settings, or store them,\n");
+    printf("\t\tneeds --no-cycle-log\n");
+    printf("procsim --sweep [-t threads] [--prune T] [--converge T] [--cache file] [traces/file.trace ...]\n");
+    printf("  --sweep\tSimulate all the configurations of run_experiments.py in process\n");
+    printf("  -t N\t\tNumber of threads used by the sweep, or to decompress a block compressed trace (default: number of cores)\n");
+    printf("  --cache file\tReuse the results of the configurations simulated by earlier sweeps, and store the new ones\n");
+    printf("  --prune T\tSkip the configurations with more resources than one within a fraction T of their IPC limit\n");
     exit(0);
 }
 
 //
-// read_instruction
+// parse_fu_values
 //
-//  returns true if an instruction was read successfully
+//  returns true if the argument is a comma separated value, of at least 1, for every FU type
 //
-bool read_instruction(proc_inst_t* p_inst)
+bool parse_fu_values(const char* arg, uint64_t values[3])
 {
-    int ret;
-    
-    if (p_inst == NULL)
-    {
-        fprintf(stderr, "Fetch requires a valid pointer to populate\n");
-        return false;
-    }
-    
-    ret = fscanf(stdin, "%x %d %d %d %d\n", &p_inst->instruction_address,
-                 &p_inst->op_code, &p_inst->dest_reg, &p_inst->src_reg[0], &p_inst->src_reg[1]); 
-    if (ret != 5) {
+    char end;
+    if (sscanf(arg, "%" SCNu64 ",%" SCNu64 ",%" SCNu64 "%c", &values[0], &values[1], &values[2], &end) != 3) {
         return false;
     }
-    
-    return true;
+    return (values[0] > 0) && (values[1] > 0) && (values[2] > 0);
 }
 
 void print_statistics(proc_stats_t* p_stats);
+void print_thread_statistics(proc_stats_t* p_stats, const std::vector<std::string>& traceFiles);
+void print_cpi_stack(proc_stats_t* p_stats);
+bool write_cpi_stack_json(const char* fileName, proc_stats_t* p_stats);
+
+int run_simpoints(const char* simpointsName, const char* traceName,
+                  uint64_t r, uint64_t k0, uint64_t k1, uint64_t k2, uint64_t f, uint64_t warmup,
+                  double targetError) {
+    uint64_t interval;
+    std::vector<simpoint_t> points;
+    if (!read_simpoints(simpointsName, &interval, points)) {
+        fprintf(stderr, "Failed to read simulation points from %s\n", simpointsName);
+        return 1;
+    }
+    TraceBuffer trace;
+    if ((traceName == NULL) || !trace.load(traceName)) {
+        fprintf(stderr, "Simulation points need a trace given with -i\n");
+        return 1;
+    }
+
+    sweep_config_t config = {r, f, {k0, k1, k2}};
+    simpoint_stats_t stats;
+    simulate_simpoints(config, trace, interval, (warmup == UINT64_MAX) ? interval : warmup, points, targetError, &stats);
+
+    printf("Simulation points:\n");
+    printf("INTERVAL\tCLUSTER\tWEIGHT\tIPC\n");
+    for (size_t p = 0; p < stats.points.size(); ++p) {
+        printf("%" PRIu64 "\t%" PRIu32 "\t%f\t%f\n", stats.points[p].interval, stats.points[p].cluster, stats.points[p].weight, stats.point_ipc[p]);
+    }
+    printf("\n");
+    printf("Estimated inst retired per cycle: %f\n", stats.ipc);
+    if (stats.ipc_error < 0.0) {
+        printf("Estimate error (95%% confidence): unknown, a cluster has a single simulation point\n");
+    }
+    else {
+        printf("Estimate error (95%% confidence): %f\n", stats.ipc_error);
+    }
+    return 0;
+}
 
 int main(int argc, char* argv[]) {
     int opt;
@@ -52,10 +127,192 @@ int main(int argc, char* argv[]) {
     uint64_t k1 = DEFAULT_K1;
     uint64_t k2 = DEFAULT_K2;
     uint64_t r = DEFAULT_R;
+    bool sweep = false;
+    double prune = -1.0;
+    convergence_params_t convergence = {DEFAULT_CONVERGENCE_WINDOW, -1.0, 0};
+    unsigned threads = std::thread::hardware_concurrency();
+    const char* traceName = NULL;
+    const char* simpointsName = NULL;
+    uint64_t warmup = UINT64_MAX;
+    double simpointError = SIMPOINT_TARGET_ERROR;
+    unsigned long checkpointAt = 0;
+    const char* checkpointName = NULL;
+    const char* restoreName = NULL;
+    uint64_t latency[] = {1, 1, 1};
+    uint64_t interval[] = {1, 1, 1};
+    bool fuTiming = false;
+    const char* issuePolicy = "oldest";
+    const char* busPolicy = "oldest";
+    size_t prefetch = 0;
+    bool histograms = false;
+    const char* outputFormat = "text";
+    const char* outputName = NULL;
+    bool cpiStack = false;
+    const char* cpiStackName = NULL;
+    uint64_t dispatchQueue = 0;
+    uint64_t dispatchWidth = 0;
+    std::vector<std::string> smtTraceFiles;
+    const char* cacheName = NULL;
+    const char* fetchPolicy = "round-robin";
+
+    static struct option long_options[] = {
+        {"sweep", no_argument, NULL, 's'},
+        {"simpoints", required_argument, NULL, 'p'},
+        {"warmup", required_argument, NULL, 'w'},
+        {"simpoint-error", required_argument, NULL, 'E'},
+        {"checkpoint-at", required_argument, NULL, 'c'},
+        {"checkpoint", required_argument, NULL, 'o'},
+        {"restore", required_argument, NULL, 'x'},
+        {"latency", required_argument, NULL, 'L'},
+        {"ii", required_argument, NULL, 'I'},
+        {"prefetch", required_argument, NULL, 'P'},
+        {"histograms", no_argument, NULL, 'H'},
+        {"output", required_argument, NULL, 'O'},
+        {"output-file", required_argument, NULL, 'F'},
+        {"no-cycle-log", no_argument, NULL, 'N'},
+        {"cpi-stack", no_argument, NULL, 'C'},
+        {"cpi-stack-json", required_argument, NULL, 'J'},
+        {"prune", required_argument, NULL, 'D'},
+        {"issue-policy", required_argument, NULL, 'S'},
+        {"bus-policy", required_argument, NULL, 'G'},
+        {"converge", required_argument, NULL, 'T'},
+        {"window", required_argument, NULL, 'W'},
+        {"budget", required_argument, NULL, 'B'},
+        {"dispatch-queue", required_argument, NULL, 'q'},
+        {"dispatch-width", required_argument, NULL, 'd'},
+        {"smt", required_argument, NULL, 'M'},
+        {"cache", required_argument, NULL, 'K'},
+        {"fetch-policy", required_argument, NULL, 'Q'},
+        {NULL, 0, NULL, 0}
+    };
 
     /* Read arguments */ 
-    while(-1 != (opt = getopt(argc, argv, "r:i:j:k:l:f:h"))) {
+    while(-1 != (opt = getopt_long(argc, argv, "r:i:j:k:l:f:t:h", long_options, NULL))) {
         switch(opt) {
+        case 's':
+            sweep = true;
+            break;
+        case 'T':
+            convergence.tolerance = strtod(optarg, NULL);
+            if (convergence.tolerance <= 0.0) {
+                fprintf(stderr, "--converge expects a positive fraction\n");
+                return 1;
+            }
+            break;
+        case 'W':
+            convergence.window = strtoull(optarg, NULL, 10);
+            if (convergence.window == 0) {
+                fprintf(stderr, "--window expects at least 1 instruction\n");
+                return 1;
+            }
+            break;
+        case 'B':
+            convergence.budget = strtoull(optarg, NULL, 10);
+            break;
+        case 'D':
+            prune = strtod(optarg, NULL);
+            if ((prune < 0.0) || (prune >= 1.0)) {
+                fprintf(stderr, "--prune expects a fraction in [0, 1)\n");
+                return 1;
+            }
+            break;
+        case 'p':
+            simpointsName = optarg;
+            break;
+        case 'w':
+            warmup = strtoull(optarg, NULL, 10);
+            break;
+        case 'E':
+            simpointError = strtod(optarg, NULL);
+            if (simpointError <= 0.0) {
+                fprintf(stderr, "--simpoint-error expects a positive fraction\n");
+                return 1;
+            }
+            break;
+        case 'c':
+            checkpointAt = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            checkpointName = optarg;
+            break;
+        case 'x':
+            restoreName = optarg;
+            break;
+        case 'L':
+            if (!parse_fu_values(optarg, latency)) {
+                fprintf(stderr, "--latency needs a latency of at least 1 for every FU type, like 3,1,1\n");
+                print_help_and_exit();
+            }
+            fuTiming = true;
+            break;
+        case 'I':
+            if (!parse_fu_values(optarg, interval)) {
+                fprintf(stderr, "--ii needs an initiation interval of at least 1 for every FU type, like 1,1,1\n");
+                print_help_and_exit();
+            }
+            fuTiming = true;
+            break;
+        case 'q':
+            dispatchQueue = strtoull(optarg, NULL, 10);
+            if (dispatchQueue == 0) {
+                fprintf(stderr, "--dispatch-queue expects at least 1 instruction\n");
+                return 1;
+            }
+            break;
+        case 'd':
+            dispatchWidth = strtoull(optarg, NULL, 10);
+            if (dispatchWidth == 0) {
+                fprintf(stderr, "--dispatch-width expects at least 1 instruction\n");
+                return 1;
+            }
+            break;
+        case 'K':
+            cacheName = optarg;
+            break;
+        case 'M':
+            smtTraceFiles.clear();
+            for (const char* name = optarg; ; ++name) {
+                const char* comma = strchr(name, ',');
+                smtTraceFiles.push_back((comma != NULL) ? std::string(name, comma) : std::string(name));
+                if (comma == NULL) {
+                    break;
+                }
+                name = comma;
+            }
+            break;
+        case 'Q':
+            fetchPolicy = optarg;
+            break;
+        case 'S':
+            issuePolicy = optarg;
+            break;
+        case 'G':
+            busPolicy = optarg;
+            break;
+        case 'P':
+            prefetch = strtoul(optarg, NULL, 10);
+            break;
+        case 'H':
+            histograms = true;
+            break;
+        case 'O':
+            outputFormat = optarg;
+            break;
+        case 'F':
+            outputName = optarg;
+            break;
+        case 'N':
+            outputFormat = "null";
+            break;
+        case 'C':
+            cpiStack = true;
+            break;
+        case 'J':
+            cpiStackName = optarg;
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
         case 'r':
             r = atoi(optarg);
             break;
@@ -72,6 +329,25 @@ int main(int argc, char* argv[]) {
             f = atoi(optarg);
             break;
         case 'i':
+            traceName = optarg;
+            if (BinaryTrace::isBinaryTrace(optarg))
+            {
+                if (!binaryTrace.open(optarg))
+                {
+                    fprintf(stderr, "Failed to map binary trace %s\n", optarg);
+                    print_help_and_exit();
+                }
+                break;
+            }
+            if (BlockTrace::isBlockTrace(optarg))
+            {
+                if (!blockTrace.open(optarg))
+                {
+                    fprintf(stderr, "Failed to map block compressed trace %s\n", optarg);
+                    print_help_and_exit();
+                }
+                break;
+            }
             inFile = fopen(optarg, "r");
             if (inFile == NULL)
             {
@@ -87,28 +363,307 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if ((k0 > MAX_FUS_PER_TYPE) || (k1 > MAX_FUS_PER_TYPE) || (k2 > MAX_FUS_PER_TYPE)) {
+        fprintf(stderr, "At most %d FUs of each type are supported\n", MAX_FUS_PER_TYPE);
+        return 1;
+    }
+
+    if ((checkpointAt > 0) != (checkpointName != NULL)) {
+        fprintf(stderr, "--checkpoint-at and --checkpoint have to be given together\n");
+        return 1;
+    }
+
+    if (fuTiming && (sweep || (simpointsName != NULL))) {
+        fprintf(stderr, "--latency and --ii are not supported by --sweep and --simpoints\n");
+        return 1;
+    }
+
+    bool selectPolicy = (strcmp(issuePolicy, "oldest") != 0) || (strcmp(busPolicy, "oldest") != 0);
+    if (selectPolicy && (sweep || (simpointsName != NULL))) {
+        fprintf(stderr, "--issue-policy and --bus-policy are not supported by --sweep and --simpoints\n");
+        return 1;
+    }
+
+    bool boundedDispatch = (dispatchQueue > 0) || (dispatchWidth > 0);
+    if (boundedDispatch && (sweep || (simpointsName != NULL))) {
+        fprintf(stderr, "--dispatch-queue and --dispatch-width are not supported by --sweep and --simpoints\n");
+        return 1;
+    }
+
+    if ((convergence.tolerance > 0.0) && ((simpointsName != NULL) || (checkpointName != NULL) || (restoreName != NULL))) {
+        fprintf(stderr, "--converge is not supported by --simpoints, --checkpoint and --restore\n");
+        return 1;
+    }
+
+    bool smt = !smtTraceFiles.empty();
+    if (smt && ((smtTraceFiles.size() < 2) || (smtTraceFiles.size() > MAX_SMT_THREADS))) {
+        fprintf(stderr, "--smt expects from 2 to %d traces\n", MAX_SMT_THREADS);
+        return 1;
+    }
+    if (smt && (sweep || (simpointsName != NULL) || (traceName != NULL) || (checkpointName != NULL) ||
+                (restoreName != NULL) || (prefetch > 0))) {
+        fprintf(stderr, "--smt is not supported by -i, --sweep, --simpoints, --checkpoint, --restore and --prefetch\n");
+        return 1;
+    }
+
+    if ((cacheName != NULL) && (MODEL_HASH == 0)) {
+        fprintf(stderr, "--cache needs a simulator built with make, which hashes its timing model\n");
+        return 1;
+    }
+    if ((cacheName != NULL) && !sweep && ((traceName == NULL) || (strcmp(outputFormat, "null") != 0))) {
+        fprintf(stderr, "--cache needs -i and --no-cycle-log, as the cycle log is not cached\n");
+        return 1;
+    }
+    if ((cacheName != NULL) && !sweep && (histograms || (simpointsName != NULL) || (checkpointName != NULL) ||
+                                          (restoreName != NULL) || (convergence.tolerance > 0.0) || smt)) {
+        fprintf(stderr, "--cache is not supported by --histograms, --simpoints, --checkpoint, --restore, --converge and --smt\n");
+        return 1;
+    }
+
+    if (sweep) {
+        /* Remaining arguments are the traces, same defaults as run_experiments.py */
+        std::vector<std::string> traceFiles(argv + optind, argv + argc);
+        if (traceFiles.empty()) {
+            const char* names[] = {"gcc", "gobmk", "hmmer", "mcf"};
+            for (int i = 0; i < 4; ++i) {
+                traceFiles.push_back(std::string("traces/") + names[i] + ".100k.trace");
+            }
+        }
+        return run_sweep(traceFiles, threads, prune, (convergence.tolerance > 0.0) ? &convergence : NULL,
+                         cacheName) ? 0 : 1;
+    }
+
     printf("Processor Settings\n");
     printf("R: %" PRIu64 "\n", r);
     printf("k0: %" PRIu64 "\n", k0);
     printf("k1: %" PRIu64 "\n", k1);
     printf("k2: %" PRIu64 "\n", k2);
     printf("F: %"  PRIu64 "\n", f);
+    if (fuTiming) {
+        printf("Latency: %" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", latency[0], latency[1], latency[2]);
+        printf("Initiation interval: %" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", interval[0], interval[1], interval[2]);
+    }
+    if (selectPolicy) {
+        printf("Issue policy: %s\n", issuePolicy);
+        printf("Bus policy: %s\n", busPolicy);
+    }
+    if (dispatchQueue > 0) {
+        printf("Dispatch queue: %" PRIu64 "\n", dispatchQueue);
+    }
+    if (dispatchWidth > 0) {
+        printf("Dispatch width: %" PRIu64 "\n", dispatchWidth);
+    }
+    if (smt) {
+        printf("Threads: %zu\n", smtTraceFiles.size());
+        printf("Fetch policy: %s\n", fetchPolicy);
+    }
     printf("\n");
 
+    if (simpointsName != NULL) {
+        return run_simpoints(simpointsName, traceName, r, k0, k1, k2, f, warmup, simpointError);
+    }
+
     /* Setup the processor */
     setup_proc(r, k0, k1, k2, f);
+    setup_fu_timing(latency, interval);
+    if (!setup_select_policy(issuePolicy, busPolicy)) {
+        fprintf(stderr, "Unknown select policy %s or %s\n", issuePolicy, busPolicy);
+        print_help_and_exit();
+    }
+    setup_dispatch(dispatchQueue, dispatchWidth);
+    FILE* outputFile = stdout;
+    if (outputName != NULL && (outputFile = fopen(outputName, "wb")) == NULL) {
+        fprintf(stderr, "Failed to open %s for writing\n", outputName);
+        return 1;
+    }
+    if (!setup_logging(outputFormat, outputFile, histograms)) {
+        fprintf(stderr, "Unknown output format %s\n", outputFormat);
+        print_help_and_exit();
+    }
+    FileSource fileSource(inFile);
+    RecordSource recordSource(binaryTrace.begin(), binaryTrace.end());
+    BlockSource blockSource(blockTrace, threads);
+    bool blockInput = (blockTrace.blockRecords() != 0);
+    std::unique_ptr<PrefetchSource> prefetchSource;
+
+    /* Every thread fetches from its own trace, kept in memory */
+    std::vector<std::unique_ptr<TraceBuffer> > smtTraces;
+    if (smt && !setup_smt(static_cast<unsigned>(smtTraceFiles.size()), fetchPolicy)) {
+        fprintf(stderr, "Unknown fetch policy %s\n", fetchPolicy);
+        print_help_and_exit();
+    }
+    for (size_t t = 0; t < smtTraceFiles.size(); ++t) {
+        smtTraces.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer()));
+        if (!smtTraces.back()->load(smtTraceFiles[t].c_str())) {
+            fprintf(stderr, "Failed to load trace %s\n", smtTraceFiles[t].c_str());
+            return 1;
+        }
+    }
 
     /* Setup statistics */
     proc_stats_t stats;
     memset(&stats, 0, sizeof(proc_stats_t));
 
-    /* Run the processor */
-    run_proc(&stats);
+    /* Resume from a checkpoint */
+    uint64_t fetched = 0;
+    if (restoreName != NULL && !restore_proc(restoreName, &stats, &fetched))
+    {
+        fprintf(stderr, "Failed to restore %s, it needs the settings it was written with\n", restoreName);
+        return 1;
+    }
+
+    if (smt)
+    {
+        for (size_t t = 0; t < smtTraces.size(); ++t)
+        {
+            setup_thread_trace(static_cast<unsigned>(t), smtTraces[t]->begin(), smtTraces[t]->end());
+        }
+    }
+    else if (prefetch > 0)
+    {
+        /* Decode the trace on a reader thread, instructions fetched before the checkpoint are skipped */
+        InstructionSource* source = (binaryTrace.begin() != NULL) ? static_cast<InstructionSource*>(&recordSource) : &fileSource;
+        if (blockInput)
+        {
+            source = &blockSource;
+        }
+        prefetchSource.reset(new PrefetchSource(source, prefetch));
+        setup_source(prefetchSource.get());
+    }
+    else if (binaryTrace.begin() != NULL)
+    {
+        /* Fetch continues after the instructions fetched before the checkpoint */
+        setup_trace(binaryTrace.begin(), binaryTrace.end());
+    }
+    else if (blockInput)
+    {
+        /* Instructions fetched before the checkpoint are skipped by seeking to their block */
+        setup_source(&blockSource);
+    }
+    else
+    {
+        /* Instructions fetched before the checkpoint are skipped in the file */
+        setup_source(&fileSource);
+    }
+
+    if (checkpointName != NULL)
+    {
+        run_proc_until(&stats, checkpointAt);
+        if (blockSource.failed())
+        {
+            close_proc_output();
+            fprintf(stderr, "Simulation stopped at the corrupt block, no checkpoint written\n");
+            return 1;
+        }
+        if (!checkpoint_proc(checkpointName, &stats))
+        {
+            fprintf(stderr, "Failed to write checkpoint %s\n", checkpointName);
+            return 1;
+        }
+        close_proc_output();
+        printf("Checkpoint written at cycle %lu\n", stats.cycle_count);
+        return 0;
+    }
 
-    /* Finalize stats */
-    complete_proc(&stats);
+    /* Reuse the statistics of an earlier run of the same trace with the same settings */
+    result_cache_key_t cacheKey;
+    bool cachedResult = false;
+    if (cacheName != NULL)
+    {
+        TraceBuffer trace;
+        if (!trace.load(traceName))
+        {
+            fprintf(stderr, "Failed to load trace %s\n", traceName);
+            return 1;
+        }
+        sweep_config_t config = {r, f, {k0, k1, k2}};
+        cacheKey = result_cache_key(hash_trace(trace.begin(), trace.end()), trace.size(), config);
+        for (uint64_t i = 0; i < NUM_FU_TYPES; ++i)
+        {
+            cacheKey.latency[i] = latency[i];
+            cacheKey.interval[i] = interval[i];
+        }
+        select_policy_t issue, bus;
+        parse_select_policy(issuePolicy, &issue);
+        parse_select_policy(busPolicy, &bus);
+        cacheKey.issue_policy = issue;
+        cacheKey.bus_policy = bus;
+        cacheKey.dispatch_queue = dispatchQueue;
+        cacheKey.dispatch_width = dispatchWidth;
+
+        ResultCache cache;
+        if (!cache.open(cacheName))
+        {
+            fprintf(stderr, "Failed to open result cache %s\n", cacheName);
+            return 1;
+        }
+        cachedResult = cache.lookup(cacheKey, &stats);
+        fprintf(stderr, "%s: %s in the result cache\n", traceName, cachedResult ? "found" : "not found");
+    }
+
+    /* Run the processor, until its IPC converges if asked to */
+    convergence_t estimate;
+    bool stopped = false;
+    if (convergence.tolerance > 0.0)
+    {
+        stopped = run_proc_converged(&stats, &convergence, &estimate);
+    }
+    else if (!cachedResult)
+    {
+        run_proc(&stats);
+    }
+
+    /* A corrupt block ends fetch early, the statistics would not be of the whole trace */
+    if (blockSource.failed())
+    {
+        close_proc_output();
+        fprintf(stderr, "Simulation stopped at the corrupt block, no statistics reported\n");
+        return 1;
+    }
+
+    /* Finalize stats, and store them for later runs */
+    if (cachedResult)
+    {
+        close_proc_output();
+    }
+    else
+    {
+        complete_proc(&stats);
+    }
+    if ((cacheName != NULL) && !cachedResult)
+    {
+        ResultCache cache;
+        if (!cache.open(cacheName) || !cache.insert(cacheKey, stats))
+        {
+            fprintf(stderr, "Failed to write the statistics to the result cache %s\n", cacheName);
+        }
+    }
 
     print_statistics(&stats);
+    if (boundedDispatch) {
+        printf("Fetch stall cycles (dispatch queue full): %lu\n", stats.fetch_stall_cycles);
+        printf("Dispatch width stalls (instruction-cycles): %lu\n", stats.stall_dispatch_width);
+    }
+    if (smt) {
+        print_thread_statistics(&stats, smtTraceFiles);
+    }
+    if (fuTiming) {
+        printf("Avg execute latency (cycles): %f\n", (stats.retired_instruction > 0) ? (static_cast<double>(stats.exec_cycles) / stats.retired_instruction) : 0.0);
+    }
+
+    if (convergence.tolerance > 0.0) {
+        printf("Estimated IPC: %f +/- %f (%s after %" PRIu64 " instructions, %" PRIu64 " windows)\n", estimate.ipc,
+               estimate.error, !stopped ? "trace ended" : (estimate.converged ? "converged" : "budget spent"),
+               estimate.instructions, estimate.windows);
+    }
+
+    if (cpiStack) {
+        print_cpi_stack(&stats);
+    }
+    if (cpiStackName != NULL && !write_cpi_stack_json(cpiStackName, &stats)) {
+        fprintf(stderr, "Failed to write %s\n", cpiStackName);
+        return 1;
+    }
 
     return 0;
 }
@@ -123,3 +678,72 @@ void print_statistics(proc_stats_t* p_stats) {
 	printf("Total run time (cycles): %lu\n", p_stats->cycle_count);
 }
 
+void print_thread_statistics(proc_stats_t* p_stats, const std::vector<std::string>& traceFiles) {
+    printf("Thread stats:\n");
+    printf("THREAD\tTRACE\tINSTRUCTIONS\tCYCLES\tIPC\n");
+    for (unsigned long t = 0; t < p_stats->threads; ++t) {
+        /* a thread runs until its last instruction retires */
+        unsigned long cycles = p_stats->thread_cycles[t];
+        printf("%lu\t%s\t%lu\t%lu\t%f\n", t, traceFiles[t].c_str(), p_stats->thread_retired[t], cycles,
+               (cycles > 0) ? (static_cast<double>(p_stats->thread_retired[t]) / cycles) : 0.0);
+    }
+    printf("Total IPC: %f\n", p_stats->avg_inst_retired);
+}
+
+//
+// cpi_component
+//
+//  returns the part of the CPI caused by the given number of issue slots
+//
+double cpi_component(proc_stats_t* p_stats, unsigned long slots) {
+    if (p_stats->slots_total == 0 || p_stats->retired_instruction == 0) {
+        return 0.0;
+    }
+    double cpi = static_cast<double>(p_stats->cycle_count) / p_stats->retired_instruction;
+    return cpi * slots / p_stats->slots_total;
+}
+
+void print_cpi_stack(proc_stats_t* p_stats) {
+    printf("CPI stack:\n");
+    printf("Base (fired): %f\n", cpi_component(p_stats, p_stats->slots_fired));
+    printf("Scheduling queue full: %f\n", cpi_component(p_stats, p_stats->slots_sched_full));
+    printf("No free FU: %f\n", cpi_component(p_stats, p_stats->slots_no_fu));
+    printf("FU held by result waiting for bus: %f\n", cpi_component(p_stats, p_stats->slots_result_bus));
+    printf("Operands not ready: %f\n", cpi_component(p_stats, p_stats->slots_operands));
+    printf("Dispatch width: %f\n", cpi_component(p_stats, p_stats->slots_dispatch_width));
+    printf("Front end: %f\n", cpi_component(p_stats, p_stats->slots_frontend));
+    printf("Total CPI: %f\n", cpi_component(p_stats, p_stats->slots_total));
+    printf("Stalls (instruction-cycles):\n");
+    printf("Scheduling queue full: %lu\n", p_stats->stall_sched_full);
+    printf("No free FU: %lu\n", p_stats->stall_no_fu);
+    printf("Operands not ready: %lu\n", p_stats->stall_operands);
+    printf("Waiting for result bus: %lu\n", p_stats->stall_result_bus);
+}
+
+bool write_cpi_stack_json(const char* fileName, proc_stats_t* p_stats) {
+    FILE* f = fopen(fileName, "w");
+    if (f == NULL) {
+        return false;
+    }
+    fprintf(f, "{\n");
+    fprintf(f, "  \"cycles\": %lu,\n", p_stats->cycle_count);
+    fprintf(f, "  \"retired\": %lu,\n", p_stats->retired_instruction);
+    fprintf(f, "  \"cpi\": {\n");
+    fprintf(f, "    \"base\": %f,\n", cpi_component(p_stats, p_stats->slots_fired));
+    fprintf(f, "    \"sched_full\": %f,\n", cpi_component(p_stats, p_stats->slots_sched_full));
+    fprintf(f, "    \"no_fu\": %f,\n", cpi_component(p_stats, p_stats->slots_no_fu));
+    fprintf(f, "    \"result_bus\": %f,\n", cpi_component(p_stats, p_stats->slots_result_bus));
+    fprintf(f, "    \"operands\": %f,\n", cpi_component(p_stats, p_stats->slots_operands));
+    fprintf(f, "    \"dispatch_width\": %f,\n", cpi_component(p_stats, p_stats->slots_dispatch_width));
+    fprintf(f, "    \"frontend\": %f,\n", cpi_component(p_stats, p_stats->slots_frontend));
+    fprintf(f, "    \"total\": %f\n", cpi_component(p_stats, p_stats->slots_total));
+    fprintf(f, "  },\n");
+    fprintf(f, "  \"stalls\": {\n");
+    fprintf(f, "    \"sched_full\": %lu,\n", p_stats->stall_sched_full);
+    fprintf(f, "    \"no_fu\": %lu,\n", p_stats->stall_no_fu);
+    fprintf(f, "    \"operands\": %lu,\n", p_stats->stall_operands);
+    fprintf(f, "    \"result_bus\": %lu\n", p_stats->stall_result_bus);
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+    return (fclose(f) == 0);
+}
@@ -0,0 +1,345 @@
+#include "result_cache.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Function which maps a value to a pseudo random 64 bit number (splitmix64).
+ */
+static
+uint64_t
+mix(
+  uint64_t x
+)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * @brief Function which hashes the contents of a trace, so that the results of
+ *        a trace are found again whatever file or format it is read from.
+ *
+ * @param begin   Pointer to the first record of the trace.
+ * @param end     Pointer past the last record of the trace.
+ */
+uint64_t
+hash_trace(
+  const trace_record_t* const begin,
+  const trace_record_t* const end
+)
+{
+  uint64_t hash = 0;
+  for (const trace_record_t* r = begin; r != end; ++r) {
+    hash = mix(hash ^ ((static_cast<uint64_t>(r->instruction_address) << 32) | static_cast<uint32_t>(r->op_code)));
+    hash = mix(hash ^ ((static_cast<uint64_t>(static_cast<uint32_t>(r->src_reg[0])) << 32) |
+                       static_cast<uint32_t>(r->src_reg[1])));
+    hash = mix(hash ^ static_cast<uint32_t>(r->dest_reg));
+  }
+  return hash;
+}
+
+/**
+ * @brief Function which makes the key of the result of a configuration on a
+ *        trace, with the default timing of the FUs, select policies and
+ *        dispatch. Runs with other settings change them in the key.
+ *
+ * @param traceHash   Hash of the contents of the trace.
+ * @param traceSize   Number of instructions in the trace.
+ * @param config      Configuration which is simulated.
+ */
+result_cache_key_t
+result_cache_key(
+  const uint64_t traceHash,
+  const uint64_t traceSize,
+  const sweep_config_t& config
+)
+{
+  result_cache_key_t key;
+  memset(&key, 0, sizeof(result_cache_key_t));
+  key.model_hash = MODEL_HASH;
+  key.trace_hash = traceHash;
+  key.trace_size = traceSize;
+  key.r = config.r;
+  key.f = config.f;
+  for (uint64_t i = 0; i < NUM_FU_TYPES; ++i) {
+    key.k[i] = config.k[i];
+    key.latency[i] = 1;
+    key.interval[i] = 1;
+  }
+  key.issue_policy = SELECT_OLDEST;
+  key.bus_policy = SELECT_OLDEST;
+  // an unbounded dispatch queue, dispatching as many instructions as the scheduling queue takes
+  key.dispatch_queue = 0;
+  key.dispatch_width = 0;
+  return key;
+}
+
+/**
+ * @brief Default constructor, creates a closed cache.
+ */
+ResultCache::ResultCache(
+) : m_fd(-1),
+  m_mapping(NULL),
+  m_mappingSize(0),
+  m_header(NULL),
+  m_entries(NULL)
+{
+}
+
+/**
+ * @brief Destructor, writes back and unlocks the cache if it is open.
+ */
+ResultCache::~ResultCache(
+)
+{
+  close();
+}
+
+/**
+ * @brief Function which opens a result cache, creating it if the file does
+ *        not exist, and waits until no other process has it open. A cache
+ *        written by another version of the simulator is emptied, a file which
+ *        is not a result cache is left alone. The results of other timing
+ *        models stay in the cache, their keys differ. A simulator built
+ *        without MODEL_HASH cannot open a cache.
+ *
+ * @param fileName  Name of the result cache file.
+ *
+ * @return  true if the cache was opened.
+ */
+bool
+ResultCache::open(
+  const char* const fileName
+)
+{
+  close();
+  if (MODEL_HASH == 0) {
+    return false;
+  }
+
+  m_fd = ::open(fileName, O_RDWR | O_CREAT, 0644);
+  if ((m_fd < 0) || (flock(m_fd, LOCK_EX) != 0)) {
+    close();
+    return false;
+  }
+  struct stat st;
+  if (fstat(m_fd, &st) != 0) {
+    close();
+    return false;
+  }
+
+  size_t size = static_cast<size_t>(st.st_size);
+  if (size > 0) {
+    result_cache_header_t header;
+    if ((size < sizeof(result_cache_header_t)) ||
+        (pread(m_fd, &header, sizeof(result_cache_header_t), 0) != sizeof(result_cache_header_t)) ||
+        (memcmp(header.magic, RESULT_CACHE_MAGIC, TRACE_MAGIC_SIZE) != 0)) {
+      close();
+      return false;
+    }
+    bool valid = (header.version == RESULT_CACHE_VERSION) &&
+                 (header.stats_size == sizeof(proc_stats_t)) &&
+                 (header.slots > 0) && ((header.slots & (header.slots - 1)) == 0) &&
+                 (size == (sizeof(result_cache_header_t) + header.slots * sizeof(result_cache_entry_t)));
+    if (valid) {
+      return map(header.slots);
+    }
+  }
+
+  // start a new cache, with all the slots empty
+  if ((ftruncate(m_fd, 0) != 0) || !map(RESULT_CACHE_INITIAL_SLOTS)) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Function which writes back the cache, and lets other processes open it.
+ */
+void
+ResultCache::close(
+)
+{
+  unmap();
+  if (m_fd >= 0) {
+    flock(m_fd, LOCK_UN);
+    ::close(m_fd);
+  }
+  m_fd = -1;
+}
+
+/**
+ * @brief Function which maps the cache file with the given number of slots,
+ *        extending it with empty slots if it is smaller. The header of an
+ *        extended file is written anew.
+ *
+ * @param slots   Number of slots, a power of 2.
+ *
+ * @return  true if the file was mapped.
+ */
+bool
+ResultCache::map(
+  const uint64_t slots
+)
+{
+  size_t size = sizeof(result_cache_header_t) + slots * sizeof(result_cache_entry_t);
+  struct stat st;
+  if (fstat(m_fd, &st) != 0) {
+    return false;
+  }
+  bool extended = (static_cast<size_t>(st.st_size) < size);
+  if (extended && (ftruncate(m_fd, size) != 0)) {
+    return false;
+  }
+  void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  m_mapping = mapping;
+  m_mappingSize = size;
+  m_header = static_cast<result_cache_header_t*>(m_mapping);
+  m_entries = reinterpret_cast<result_cache_entry_t*>(m_header + 1);
+  if (extended) {
+    memset(m_header, 0, sizeof(result_cache_header_t));
+    memcpy(m_header->magic, RESULT_CACHE_MAGIC, TRACE_MAGIC_SIZE);
+    m_header->version = RESULT_CACHE_VERSION;
+    m_header->stats_size = sizeof(proc_stats_t);
+    m_header->slots = slots;
+    m_header->count = 0;
+  }
+  return true;
+}
+
+/**
+ * @brief Function which unmaps the cache file, the results written to the
+ *        mapping are in the file from then on.
+ */
+void
+ResultCache::unmap(
+)
+{
+  if (m_mapping != NULL) {
+    munmap(m_mapping, m_mappingSize);
+  }
+  m_mapping = NULL;
+  m_mappingSize = 0;
+  m_header = NULL;
+  m_entries = NULL;
+}
+
+/**
+ * @brief Function which finds the slot of a key, by linear probing from the
+ *        slot given by its hash.
+ *
+ * @param key   Key of the result.
+ *
+ * @return  Slot holding the key, or the empty slot where it would be inserted.
+ */
+result_cache_entry_t*
+ResultCache::find(
+  const result_cache_key_t& key
+) const
+{
+  uint64_t hash = 0;
+  const uint64_t* words = reinterpret_cast<const uint64_t*>(&key);
+  for (size_t i = 0; i < sizeof(result_cache_key_t) / sizeof(uint64_t); ++i) {
+    hash = mix(hash ^ words[i]);
+  }
+  const uint64_t mask = m_header->slots - 1;
+  for (uint64_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+    result_cache_entry_t* entry = &m_entries[slot];
+    if (!entry->used || (memcmp(&entry->key, &key, sizeof(result_cache_key_t)) == 0)) {
+      return entry;
+    }
+  }
+}
+
+/**
+ * @brief Function which looks up the result of a key.
+ *
+ * @param key       Key of the result.
+ * @param p_stats   Pointer to the statistics structure to populate on a hit.
+ *
+ * @return  true if the cache holds the result.
+ */
+bool
+ResultCache::lookup(
+  const result_cache_key_t& key,
+  proc_stats_t* const p_stats
+) const
+{
+  if (m_header == NULL) {
+    return false;
+  }
+  const result_cache_entry_t* entry = find(key);
+  if (!entry->used) {
+    return false;
+  }
+  *p_stats = entry->stats;
+  return true;
+}
+
+/**
+ * @brief Function which stores the result of a key, replacing the one it
+ *        had if any. The index is doubled first if it is half full.
+ *
+ * @param key     Key of the result.
+ * @param stats   Statistics of the simulation.
+ *
+ * @return  true if the result was stored.
+ */
+bool
+ResultCache::insert(
+  const result_cache_key_t& key,
+  const proc_stats_t& stats
+)
+{
+  if ((m_header == NULL) || ((2 * (m_header->count + 1) > m_header->slots) && !grow())) {
+    return false;
+  }
+  result_cache_entry_t* entry = find(key);
+  if (!entry->used) {
+    entry->used = 1;
+    entry->key = key;
+    ++m_header->count;
+  }
+  entry->stats = stats;
+  return true;
+}
+
+/**
+ * @brief Function which doubles the number of slots, and inserts the results
+ *        again in their slots of the larger index.
+ *
+ * @return  true if the index was doubled.
+ */
+bool
+ResultCache::grow(
+)
+{
+  std::vector<result_cache_entry_t> entries;
+  for (uint64_t slot = 0; slot < m_header->slots; ++slot) {
+    if (m_entries[slot].used) {
+      entries.push_back(m_entries[slot]);
+    }
+  }
+  uint64_t slots = 2 * m_header->slots;
+  unmap();
+  if ((ftruncate(m_fd, 0) != 0) || !map(slots)) {
+    return false;
+  }
+  for (std::vector<result_cache_entry_t>::const_iterator e = entries.begin(); e != entries.end(); ++e) {
+    result_cache_entry_t* entry = find(e->key);
+    *entry = *e;
+    ++m_header->count;
+  }
+  return true;
+}
@@ -0,0 +1,108 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include "sweep.hpp"
+
+#define RESULT_CACHE_MAGIC "PSIMRES"
+#define RESULT_CACHE_VERSION 3
+
+// hash of the sources of the timing model, computed by the Makefile, so that
+// the results of a simulator with another timing model are never reused. A
+// simulator built without it has no result cache.
+#ifndef MODEL_HASH
+#define MODEL_HASH 0
+#endif
+
+// number of slots of a new result cache, doubled whenever it is half full
+#define RESULT_CACHE_INITIAL_SLOTS 1024
+
+/**
+ * @brief Header at the start of every result cache file. The slots of the
+ *        index follow it, and hold the results themselves.
+ */
+typedef struct _result_cache_header_t {
+  char magic[TRACE_MAGIC_SIZE];
+  uint32_t version;
+  // size of the statistics, which are stored as they are in memory
+  uint32_t stats_size;
+  uint64_t slots;
+  uint64_t count;
+} result_cache_header_t;
+
+/**
+ * @brief Key of a result, made of the timing model, the contents of the trace
+ *        and all the settings of the processor which change its timing.
+ */
+typedef struct _result_cache_key_t {
+  uint64_t model_hash;
+  uint64_t trace_hash;
+  uint64_t trace_size;
+  uint64_t r;
+  uint64_t f;
+  uint64_t k[NUM_FU_TYPES];
+  uint64_t latency[NUM_FU_TYPES];
+  uint64_t interval[NUM_FU_TYPES];
+  uint64_t issue_policy;
+  uint64_t bus_policy;
+  uint64_t dispatch_queue;
+  uint64_t dispatch_width;
+} result_cache_key_t;
+
+/**
+ * @brief Slot of the index, empty unless used is set.
+ */
+typedef struct _result_cache_entry_t {
+  uint64_t used;
+  result_cache_key_t key;
+  proc_stats_t stats;
+} result_cache_entry_t;
+
+uint64_t hash_trace(const trace_record_t* const, const trace_record_t* const);
+
+result_cache_key_t result_cache_key(const uint64_t, const uint64_t, const sweep_config_t&);
+
+/**
+ * @brief Results of whole trace simulations kept on disk across runs, in a
+ *        single memory mapped file indexed by an open addressed hash table.
+ *        The file is locked while it is open, so several sweeps can share it.
+ */
+class ResultCache {
+public:
+  ResultCache();
+
+  ~ResultCache();
+
+  bool open(const char* const);
+
+  void close();
+
+  bool lookup(const result_cache_key_t&, proc_stats_t* const) const;
+
+  bool insert(const result_cache_key_t&, const proc_stats_t&);
+
+  uint64_t size() const { return (m_header != NULL) ? m_header->count : 0; }
+
+private:
+  ResultCache(const ResultCache&);
+
+  ResultCache& operator=(const ResultCache&);
+
+  bool map(const uint64_t);
+
+  void unmap();
+
+  result_cache_entry_t* find(const result_cache_key_t&) const;
+
+  bool grow();
+
+private:
+  int m_fd;
+
+  void* m_mapping;
+  size_t m_mappingSize;
+
+  result_cache_header_t* m_header;
+  result_cache_entry_t* m_entries;
+};
+
+#endif /* RESULT_CACHE_HPP */
@@ -0,0 +1,155 @@
+#include "scheduling_queue.hpp"
+
+#include "checkpoint.hpp"
+
+// smallest slab, so that the occupancy bitmask is made of whole words
+#define MIN_SLAB_SIZE 64
+
+/**
+ * @brief Default constructor, creates a queue with the smallest slab.
+ */
+SchedulingQueue::SchedulingQueue(
+) : m_slots(),
+  m_occupied(),
+  m_ready(),
+  m_mask(0),
+  m_oldest(0),
+  m_end(0),
+  m_size(0)
+{
+  resize(MIN_SLAB_SIZE);
+}
+
+/**
+ * @brief Constructor for a queue which can hold the given number of instructions.
+ *
+ * @param capacity  Capacity of the scheduling queue.
+ */
+SchedulingQueue::SchedulingQueue(
+  const uint64_t capacity
+) : m_slots(),
+  m_occupied(),
+  m_ready(),
+  m_mask(0),
+  m_oldest(0),
+  m_end(0),
+  m_size(0)
+{
+  uint64_t size = MIN_SLAB_SIZE;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  resize(size);
+}
+
+/**
+ * @brief Function which inserts an instruction, its tag has to be newer than
+ *        the tags of all the instructions in the queue.
+ *
+ * @param rs  Reservation station of the instruction.
+ */
+void
+SchedulingQueue::insert(
+  const reservation_station_t& rs
+)
+{
+  uint32_t tag = rs.dest_reg_tag;
+  if (m_size == 0) {
+    m_oldest = tag;
+  }
+  else if ((tag - m_oldest) > m_mask) {
+    // an old instruction is still waiting while the newer ones have moved on
+    // and the tags of the queue do not fit in the slab, which is rare enough
+    // to grow the slab instead of making the dispatch stall
+    uint64_t size = static_cast<uint64_t>(m_mask) + 1;
+    while ((tag - m_oldest) >= size) {
+      size <<= 1;
+    }
+    resize(size);
+  }
+  m_slots[tag & m_mask] = rs;
+  m_occupied[(tag & m_mask) >> 6] |= (static_cast<uint64_t>(1) << (tag & 63));
+  m_end = tag + 1;
+  ++m_size;
+}
+
+/**
+ * @brief Function which removes an instruction from the queue.
+ *
+ * @param tag   Tag of the instruction.
+ */
+void
+SchedulingQueue::erase(
+  const uint32_t tag
+)
+{
+  m_occupied[(tag & m_mask) >> 6] &= ~(static_cast<uint64_t>(1) << (tag & 63));
+  clearReady(tag);
+  --m_size;
+  if (tag == m_oldest) {
+    m_oldest = (m_size > 0) ? next(tag) : m_end;
+  }
+}
+
+/**
+ * @brief Function which moves the instructions to a slab of the given size.
+ *
+ * @param size  New size of the slab, a power of two.
+ */
+void
+SchedulingQueue::resize(
+  const uint64_t size
+)
+{
+  std::vector<reservation_station_t> slots(size);
+  std::vector<uint64_t> occupied(size / 64, 0);
+  std::vector<uint64_t> ready(size / 64, 0);
+  uint32_t mask = static_cast<uint32_t>(size - 1);
+  for (uint32_t tag = begin(); (m_size > 0) && (tag != end()); tag = next(tag)) {
+    slots[tag & mask] = m_slots[tag & m_mask];
+    occupied[(tag & mask) >> 6] |= (static_cast<uint64_t>(1) << (tag & 63));
+    if (this->ready(tag)) {
+      ready[(tag & mask) >> 6] |= (static_cast<uint64_t>(1) << (tag & 63));
+    }
+  }
+  m_slots.swap(slots);
+  m_occupied.swap(occupied);
+  m_ready.swap(ready);
+  m_mask = mask;
+}
+
+/**
+ * @brief Function which writes the queue to a checkpoint.
+ *
+ * @param f   Checkpoint file.
+ */
+bool
+SchedulingQueue::save(
+  FILE* const f
+) const
+{
+  uint64_t size = m_size;
+  return write_vector(f, m_slots) && write_vector(f, m_occupied) && write_vector(f, m_ready) &&
+         write_value(f, m_mask) && write_value(f, m_oldest) && write_value(f, m_end) && write_value(f, size);
+}
+
+/**
+ * @brief Function which reads the queue from a checkpoint.
+ *
+ * @param f   Checkpoint file.
+ */
+bool
+SchedulingQueue::load(
+  FILE* const f
+)
+{
+  uint64_t size;
+  if (!(read_vector(f, m_slots) && read_vector(f, m_occupied) && read_vector(f, m_ready) &&
+        read_value(f, m_mask) && read_value(f, m_oldest) && read_value(f, m_end) && read_value(f, size))) {
+    return false;
+  }
+  m_size = size;
+  // the slab and the bitmasks have to agree with the mask
+  return (m_slots.size() == (static_cast<uint64_t>(m_mask) + 1)) &&
+         (m_occupied.size() == (m_slots.size() / 64)) && (m_ready.size() == m_occupied.size());
+}
@@ -0,0 +1,169 @@
+#ifndef SCHEDULING_QUEUE_HPP
+#define SCHEDULING_QUEUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// end of a list of consumers
+#define NO_CONSUMER UINT64_MAX
+
+/**
+ * @brief enum for specifying state of an instruction in scheduling queue
+ */
+enum schedule_status_t {
+  DISPATCHED,
+  SCHEDULED,
+  EXECUTED,
+  COMPLETED
+};
+
+/**
+ * @brief struct for storing each scheduling queue entry
+ */
+typedef struct _reservation_station_t {
+  int32_t op_code;
+  bool src_reg_ready[2];
+  uint32_t src_reg_tag[2];
+  int32_t dest_reg;
+  uint32_t dest_reg_tag;
+
+  unsigned long clock_stamp;
+  schedule_status_t status;
+
+  // functional unit which holds the instruction after it is scheduled
+  uint32_t fu;
+
+  // hardware thread of the instruction
+  uint32_t thread;
+
+  // consumers waiting for the result of this instruction, linked through the
+  // next_consumer fields of their source operands, each encoded as (tag << 1 | operand)
+  uint64_t first_consumer;
+  uint64_t next_consumer[2];
+
+  // number of consumers linked to this instruction, and the length of the longest
+  // chain of dispatched instructions which depend on it, for the select policies
+  uint32_t dependents;
+  uint32_t height;
+
+  bool operator==(const _reservation_station_t& rs) const
+  {
+    return (dest_reg_tag == rs.dest_reg_tag);
+  }
+
+} reservation_station_t;
+
+/**
+ * @brief Scheduling queue backed by a preallocated slab of reservation stations.
+ *        An instruction lives in the slot given by its tag modulo the slab size,
+ *        and an occupancy bitmask over the slots is walked starting from the
+ *        oldest tag, so the entries are visited in the order of their tags.
+ *        Tags have to be inserted in increasing order. A second bitmask keeps
+ *        track of the dispatched instructions which have all their operands,
+ *        so that these can be visited in tag order without looking at the others.
+ */
+class SchedulingQueue {
+public:
+  SchedulingQueue();
+
+  explicit SchedulingQueue(const uint64_t);
+
+  size_t size() const { return m_size; }
+
+  size_t allocatedBytes() const
+  {
+    return (m_slots.capacity() * sizeof(reservation_station_t)) +
+           ((m_occupied.capacity() + m_ready.capacity()) * sizeof(uint64_t));
+  }
+
+  reservation_station_t& operator[](const uint32_t tag) { return m_slots[tag & m_mask]; }
+
+  const reservation_station_t& operator[](const uint32_t tag) const { return m_slots[tag & m_mask]; }
+
+  void insert(const reservation_station_t&);
+
+  void erase(const uint32_t);
+
+  // tag of the oldest entry, equal to end() if the queue is empty
+  uint32_t begin() const { return m_oldest; }
+
+  // tag after the newest entry
+  uint32_t end() const { return m_end; }
+
+  uint32_t next(const uint32_t tag) const { return nextSet(m_occupied, tag); }
+
+  // tag of the oldest ready entry, equal to end() if there is none
+  uint32_t beginReady() const { return ((m_size == 0) || ready(m_oldest)) ? m_oldest : nextReady(m_oldest); }
+
+  uint32_t nextReady(const uint32_t tag) const { return nextSet(m_ready, tag); }
+
+  bool save(FILE* const) const;
+
+  bool load(FILE* const);
+
+  void setReady(const uint32_t tag) { m_ready[(tag & m_mask) >> 6] |= (static_cast<uint64_t>(1) << (tag & 63)); }
+
+  void clearReady(const uint32_t tag) { m_ready[(tag & m_mask) >> 6] &= ~(static_cast<uint64_t>(1) << (tag & 63)); }
+
+private:
+  void resize(const uint64_t);
+
+  uint32_t nextSet(const std::vector<uint64_t>&, const uint32_t) const;
+
+  bool ready(const uint32_t tag) const { return (m_ready[(tag & m_mask) >> 6] >> (tag & 63)) & 1; }
+
+  bool occupied(const uint32_t tag) const { return (m_occupied[(tag & m_mask) >> 6] >> (tag & 63)) & 1; }
+
+private:
+  std::vector<reservation_station_t> m_slots;
+
+  // one bit per slot, set if the slot holds an instruction
+  std::vector<uint64_t> m_occupied;
+
+  // one bit per slot, set if the instruction in the slot is ready to be scheduled
+  std::vector<uint64_t> m_ready;
+
+  uint32_t m_mask;
+  uint32_t m_oldest;
+  uint32_t m_end;
+
+  size_t m_size;
+};
+
+/**
+ * @brief Function which finds the tag of the entry after the given tag,
+ *        among the entries which have their bit set in a mask.
+ *
+ * @param mask  Bitmask over the slots.
+ * @param tag   Tag to start the search after.
+ *
+ * @return  Tag of the next entry, or end() if there is none.
+ */
+inline
+uint32_t
+SchedulingQueue::nextSet(
+  const std::vector<uint64_t>& mask,
+  const uint32_t tag
+) const
+{
+  uint32_t t = tag + 1;
+  while (t != m_end) {
+    // look at the slots of the current word, from the slot of tag t onwards
+    uint32_t bit = t & 63;
+    uint64_t bits = mask[(t & m_mask) >> 6] >> bit;
+    uint32_t remaining = m_end - t;
+    if (bits != 0) {
+      uint32_t skip = static_cast<uint32_t>(__builtin_ctzll(bits));
+      return (skip < remaining) ? (t + skip) : m_end;
+    }
+    if (remaining <= (64 - bit)) {
+      break;
+    }
+    t += (64 - bit);
+  }
+  return m_end;
+}
+
+#endif /* SCHEDULING_QUEUE_HPP */
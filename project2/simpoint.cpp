@@ -0,0 +1,273 @@
+#include "simpoint.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <random>
+
+// maximum number of iterations of k-means
+#define KMEANS_ITERATIONS 100
+// size of an instruction, used for finding the end of basic blocks
+#define INSTRUCTION_SIZE 4
+
+typedef std::array<double, SIMPOINT_DIMENSIONS> projection_t;
+
+/**
+ * @brief Function which maps a value to a pseudo random 64 bit number (splitmix64).
+ */
+static
+uint64_t
+mix(
+  uint64_t x
+)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * @brief Function which computes the basic block vectors of all the intervals
+ *        of a trace, projected to a few random dimensions. A basic block starts
+ *        at every instruction which does not follow its predecessor in memory.
+ *
+ * @param trace         Trace to be analyzed.
+ * @param intervalSize  Number of instructions in an interval.
+ * @param seed          Seed of the random projection.
+ */
+static
+std::vector<projection_t>
+project_intervals(
+  const TraceBuffer& trace,
+  const uint64_t intervalSize,
+  const uint64_t seed
+)
+{
+  std::vector<projection_t> projections;
+  // number of instructions executed in each basic block of the current interval
+  std::map<uint32_t, uint64_t> blocks;
+  uint32_t blockStart = 0;
+  uint32_t previousAddress = 0;
+  uint64_t n = 0;
+  for (const trace_record_t* r = trace.begin(); r != trace.end(); ++r) {
+    if ((n == 0) || (r->instruction_address != (previousAddress + INSTRUCTION_SIZE))) {
+      blockStart = r->instruction_address;
+    }
+    previousAddress = r->instruction_address;
+    ++blocks[blockStart];
+    if ((++n % intervalSize == 0) || ((r + 1) == trace.end())) {
+      projection_t p;
+      p.fill(0.0);
+      uint64_t length = (n % intervalSize == 0) ? intervalSize : (n % intervalSize);
+      for (std::map<uint32_t, uint64_t>::const_iterator b = blocks.begin(); b != blocks.end(); ++b) {
+        double frequency = static_cast<double>(b->second) / length;
+        for (uint32_t d = 0; d < SIMPOINT_DIMENSIONS; ++d) {
+          // every block has a fixed random direction with components in [-1, 1]
+          uint64_t h = mix(mix(b->first ^ seed) + d);
+          p[d] += frequency * ((static_cast<double>(h >> 11) / (1ULL << 52)) - 1.0);
+        }
+      }
+      projections.push_back(p);
+      blocks.clear();
+    }
+  }
+  return projections;
+}
+
+/**
+ * @brief Function which computes the squared distance between two projections.
+ */
+static
+double
+distance(
+  const projection_t& a,
+  const projection_t& b
+)
+{
+  double d = 0.0;
+  for (uint32_t i = 0; i < SIMPOINT_DIMENSIONS; ++i) {
+    d += (a[i] - b[i]) * (a[i] - b[i]);
+  }
+  return d;
+}
+
+/**
+ * @brief Function which splits a trace in intervals, clusters the intervals by
+ *        their basic block vectors using k-means, and lists every interval of
+ *        every cluster in the order in which it is to be simulated. The first
+ *        SIMPOINT_POINTS_PER_CLUSTER of a cluster are one random interval from
+ *        each equal run of its intervals in trace order, so that phases within
+ *        the cluster are all sampled, and the rest follow in random order, for
+ *        simulate_simpoints to add until its estimate is precise enough. Random
+ *        points, unlike the ones closest to the centroid, make the clusters the
+ *        strata of a stratified random sample, which the error estimate relies on.
+ *
+ * @param trace         Trace to be analyzed.
+ * @param intervalSize  Number of instructions in an interval.
+ * @param k             Maximum number of clusters.
+ * @param seed          Seed for the projection, the initial centroids and the points.
+ */
+std::vector<simpoint_t>
+find_simpoints(
+  const TraceBuffer& trace,
+  const uint64_t intervalSize,
+  const uint32_t k,
+  const uint64_t seed
+)
+{
+  std::vector<simpoint_t> points;
+  const std::vector<projection_t> projections = project_intervals(trace, intervalSize, seed);
+  const size_t n = projections.size();
+  if (n == 0) {
+    return points;
+  }
+  const uint32_t clusters = static_cast<uint32_t>(std::min(static_cast<size_t>(k), n));
+
+  // choose initial centroids with k-means++
+  std::mt19937_64 rng(seed);
+  std::vector<projection_t> centroids;
+  centroids.push_back(projections[rng() % n]);
+  std::vector<double> nearest(n, std::numeric_limits<double>::max());
+  while (centroids.size() < clusters) {
+    double total = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      nearest[i] = std::min(nearest[i], distance(projections[i], centroids.back()));
+      total += nearest[i];
+    }
+    if (total == 0.0) {
+      // all the remaining intervals coincide with a centroid
+      break;
+    }
+    double target = std::uniform_real_distribution<double>(0.0, total)(rng);
+    size_t chosen = 0;
+    for (; (chosen < (n - 1)) && (target >= nearest[chosen]); ++chosen) {
+      target -= nearest[chosen];
+    }
+    centroids.push_back(projections[chosen]);
+  }
+
+  // refine the clusters with Lloyd's iterations
+  std::vector<uint32_t> assignment(n, 0);
+  for (uint32_t iteration = 0; iteration < KMEANS_ITERATIONS; ++iteration) {
+    bool changed = (iteration == 0);
+    for (size_t i = 0; i < n; ++i) {
+      uint32_t best = 0;
+      for (uint32_t c = 1; c < centroids.size(); ++c) {
+        if (distance(projections[i], centroids[c]) < distance(projections[i], centroids[best])) {
+          best = c;
+        }
+      }
+      changed = changed || (assignment[i] != best);
+      assignment[i] = best;
+    }
+    if (!changed) {
+      break;
+    }
+    std::vector<uint64_t> members(centroids.size(), 0);
+    std::vector<projection_t> sums(centroids.size());
+    for (uint32_t c = 0; c < centroids.size(); ++c) {
+      sums[c].fill(0.0);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      ++members[assignment[i]];
+      for (uint32_t d = 0; d < SIMPOINT_DIMENSIONS; ++d) {
+        sums[assignment[i]][d] += projections[i][d];
+      }
+    }
+    for (uint32_t c = 0; c < centroids.size(); ++c) {
+      for (uint32_t d = 0; (members[c] > 0) && (d < SIMPOINT_DIMENSIONS); ++d) {
+        centroids[c][d] = sums[c][d] / members[c];
+      }
+    }
+  }
+
+  // weigh the clusters by their instructions, the last interval may be shorter
+  std::vector<double> weights(centroids.size(), 0.0);
+  for (size_t i = 0; i < n; ++i) {
+    uint64_t length = std::min(intervalSize, trace.size() - (i * intervalSize));
+    weights[assignment[i]] += static_cast<double>(length) / trace.size();
+  }
+  for (uint32_t c = 0; c < centroids.size(); ++c) {
+    std::vector<size_t> members;
+    for (size_t i = 0; i < n; ++i) {
+      if (assignment[i] == c) {
+        members.push_back(i);
+      }
+    }
+    // draw one point from each run of intervals, then the remaining ones in random order
+    size_t runs = std::min(members.size(), static_cast<size_t>(SIMPOINT_POINTS_PER_CLUSTER));
+    for (size_t m = 0; m < runs; ++m) {
+      size_t first = m * members.size() / runs;
+      size_t last = (m + 1) * members.size() / runs;
+      std::swap(members[m], members[first + (rng() % (last - first))]);
+    }
+    for (size_t m = runs; m < members.size(); ++m) {
+      std::swap(members[m], members[m + (rng() % (members.size() - m))]);
+    }
+    for (size_t m = 0; m < members.size(); ++m) {
+      simpoint_t point = {members[m], c, weights[c]};
+      points.push_back(point);
+    }
+  }
+  return points;
+}
+
+/**
+ * @brief Function which writes simulation points to a file.
+ *
+ * @param fileName      Name of the file.
+ * @param intervalSize  Number of instructions in an interval.
+ * @param points        Simulation points.
+ */
+bool
+write_simpoints(
+  const char* const fileName,
+  const uint64_t intervalSize,
+  const std::vector<simpoint_t>& points
+)
+{
+  FILE* f = fopen(fileName, "w");
+  if (f == NULL) {
+    return false;
+  }
+  fprintf(f, "# interval %" PRIu64 "\n", intervalSize);
+  fprintf(f, "# interval cluster weight\n");
+  for (std::vector<simpoint_t>::const_iterator p = points.begin(); p != points.end(); ++p) {
+    fprintf(f, "%" PRIu64 " %" PRIu32 " %.9f\n", p->interval, p->cluster, p->weight);
+  }
+  return (fclose(f) == 0);
+}
+
+/**
+ * @brief Function which reads simulation points from a file.
+ *
+ * @param fileName      Name of the file.
+ * @param intervalSize  Variable in which the number of instructions in an interval is returned.
+ * @param points        Vector in which the simulation points are returned.
+ */
+bool
+read_simpoints(
+  const char* const fileName,
+  uint64_t* const intervalSize,
+  std::vector<simpoint_t>& points
+)
+{
+  FILE* f = fopen(fileName, "r");
+  if (f == NULL) {
+    return false;
+  }
+  bool valid = (fscanf(f, "# interval %" SCNu64 "\n", intervalSize) == 1) && (*intervalSize > 0);
+  // skip the line describing the columns
+  int c;
+  while (valid && ((c = fgetc(f)) != EOF) && (c != '\n'));
+  simpoint_t point;
+  while (valid && (fscanf(f, "%" SCNu64 " %" SCNu32 " %lf\n", &point.interval, &point.cluster, &point.weight) == 3)) {
+    points.push_back(point);
+  }
+  fclose(f);
+  return valid && !points.empty();
+}
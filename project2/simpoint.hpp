@@ -0,0 +1,51 @@
+#ifndef SIMPOINT_HPP
+#define SIMPOINT_HPP
+
+#include "sweep.hpp"
+
+#include <string>
+#include <vector>
+
+// number of dimensions to which basic block vectors are projected
+#define SIMPOINT_DIMENSIONS 15
+// number of intervals first simulated for every cluster, one drawn at random
+// from each equal run of its intervals in trace order, so that their spread
+// gives the error of the estimate
+#define SIMPOINT_POINTS_PER_CLUSTER 8
+// default half width of the 95% confidence interval, relative to the IPC, at
+// which no more points are simulated
+#define SIMPOINT_TARGET_ERROR 0.02
+
+/**
+ * @brief Struct for storing one simulation point, an interval representing a cluster.
+ */
+typedef struct _simpoint_t {
+  uint64_t interval;
+  uint32_t cluster;
+  // fraction of the instructions of the trace which are in the cluster
+  double weight;
+} simpoint_t;
+
+/**
+ * @brief Struct for storing the result of simulating the simulation points.
+ */
+typedef struct _simpoint_stats_t {
+  double ipc;
+  // half width of the 95% confidence interval of the IPC, negative if the
+  // points do not allow estimating it
+  double ipc_error;
+  // simulated points in simulation order, with their IPCs
+  std::vector<simpoint_t> points;
+  std::vector<double> point_ipc;
+} simpoint_stats_t;
+
+std::vector<simpoint_t> find_simpoints(const TraceBuffer&, const uint64_t, const uint32_t, const uint64_t);
+
+bool write_simpoints(const char* const, const uint64_t, const std::vector<simpoint_t>&);
+
+bool read_simpoints(const char* const, uint64_t* const, std::vector<simpoint_t>&);
+
+void simulate_simpoints(const sweep_config_t&, const TraceBuffer&, const uint64_t, const uint64_t,
+                        const std::vector<simpoint_t>&, const double, simpoint_stats_t* const);
+
+#endif /* SIMPOINT_HPP */
@@ -0,0 +1,79 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <unistd.h>
+#include "simpoint.hpp"
+
+#define DEFAULT_INTERVAL 10000
+#define DEFAULT_CLUSTERS 10
+#define DEFAULT_SEED 1
+
+void print_help_and_exit(void) {
+    printf("simpoint [OPTIONS]\n");
+    printf("  -i traces/file.trace\tText or binary trace to analyze\n");
+    printf("  -o file.simpoints\tFile to write the simulation points to\n");
+    printf("  -n N\t\t\tNumber of instructions in an interval (default: %d)\n", DEFAULT_INTERVAL);
+    printf("  -k N\t\t\tMaximum number of clusters (default: %d)\n", DEFAULT_CLUSTERS);
+    printf("  -s N\t\t\tRandom seed (default: %d)\n", DEFAULT_SEED);
+    printf("  -h\t\t\tThis helpful output\n");
+    exit(0);
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    const char* traceName = NULL;
+    const char* outName = NULL;
+    uint64_t interval = DEFAULT_INTERVAL;
+    uint32_t clusters = DEFAULT_CLUSTERS;
+    uint64_t seed = DEFAULT_SEED;
+
+    while(-1 != (opt = getopt(argc, argv, "i:o:n:k:s:h"))) {
+        switch(opt) {
+        case 'i':
+            traceName = optarg;
+            break;
+        case 'o':
+            outName = optarg;
+            break;
+        case 'n':
+            interval = strtoull(optarg, NULL, 10);
+            break;
+        case 'k':
+            clusters = atoi(optarg);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'h':
+            /* Fall through */
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+
+    if ((traceName == NULL) || (outName == NULL) || (interval == 0) || (clusters == 0)) {
+        print_help_and_exit();
+    }
+
+    TraceBuffer trace;
+    if (!trace.load(traceName)) {
+        fprintf(stderr, "Failed to load trace %s\n", traceName);
+        return 1;
+    }
+
+    std::vector<simpoint_t> points = find_simpoints(trace, interval, clusters, seed);
+    if (!write_simpoints(outName, interval, points)) {
+        fprintf(stderr, "Failed to write %s\n", outName);
+        return 1;
+    }
+
+    printf("Intervals: %" PRIu64 "\n", (trace.size() + interval - 1) / interval);
+    std::set<uint32_t> clusterIds;
+    for (std::vector<simpoint_t>::const_iterator p = points.begin(); p != points.end(); ++p) {
+        clusterIds.insert(p->cluster);
+    }
+    printf("Clusters: %zu\n", clusterIds.size());
+    return 0;
+}
@@ -0,0 +1,310 @@
+#include "simpoint.hpp"
+
+#include "processor.hpp"
+
+#include <cmath>
+#include <map>
+
+// 97.5th percentiles of Student's t distribution for 1 to 30 degrees of freedom
+static const double studentT975[] = {
+  12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+  2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+/**
+ * @brief Struct for storing the points of a cluster and the CPIs of the ones simulated.
+ */
+typedef struct _cluster_sample_t {
+  double weight;
+  // points of the cluster in draw order
+  std::vector<simpoint_t> points;
+  // number of points tried so far
+  size_t drawn;
+  // number of points listed which retire instructions, as far as known
+  size_t intervals;
+  std::vector<double> cpis;
+} cluster_sample_t;
+
+/**
+ * @brief Function which simulates one simulation point on a fresh processor,
+ *        after warming it up with the instructions preceding the point.
+ *
+ * @param config        Configuration of the processor.
+ * @param trace         Trace to be simulated.
+ * @param intervalSize  Number of instructions in an interval.
+ * @param warmup        Number of instructions simulated before the point.
+ * @param point         Simulation point.
+ * @param p_cpi         Pointer to the variable in which the CPI of the point is returned.
+ *
+ * @return              False if the point retires no instruction, as past the end of the trace.
+ */
+static bool
+simulate_point(
+  const sweep_config_t& config,
+  const TraceBuffer& trace,
+  const uint64_t intervalSize,
+  const uint64_t warmup,
+  const simpoint_t& point,
+  double* const p_cpi
+)
+{
+  uint64_t start = std::min(point.interval * intervalSize, trace.size());
+  uint64_t warm = std::min(warmup, start);
+  uint64_t length = std::min(intervalSize, trace.size() - start);
+
+  Processor processor(config.r, config.k, config.f);
+  // fast forward to the warm up instructions before the point
+  processor.setTrace(trace.begin() + (start - warm), trace.end());
+  processor.runUntil(warm);
+  unsigned long startCycle = processor.cycles();
+  unsigned long startRetired = processor.retiredInstruction();
+  processor.runUntil(warm + length);
+  unsigned long retired = processor.retiredInstruction() - startRetired;
+  if (retired == 0) {
+    return false;
+  }
+  *p_cpi = static_cast<double>(processor.cycles() - startCycle) / retired;
+  return true;
+}
+
+/**
+ * @brief Function which draws the next point of a cluster that retires
+ *        instructions and simulates it. Points retiring none are dropped from
+ *        the intervals of the cluster, as they hold none of its instructions.
+ *
+ * @param config        Configuration of the processor.
+ * @param trace         Trace to be simulated.
+ * @param intervalSize  Number of instructions in an interval.
+ * @param warmup        Number of instructions simulated before the point.
+ * @param p_cluster     Pointer to the cluster.
+ * @param p_stats       Pointer to the structure in which the point and its IPC are added.
+ *
+ * @return              False if the cluster has no more points to draw.
+ */
+static bool
+draw_point(
+  const sweep_config_t& config,
+  const TraceBuffer& trace,
+  const uint64_t intervalSize,
+  const uint64_t warmup,
+  cluster_sample_t* const p_cluster,
+  simpoint_stats_t* const p_stats
+)
+{
+  while (p_cluster->drawn < p_cluster->points.size()) {
+    const simpoint_t& point = p_cluster->points[p_cluster->drawn++];
+    double cpi;
+    if (simulate_point(config, trace, intervalSize, warmup, point, &cpi)) {
+      p_cluster->cpis.push_back(cpi);
+      p_stats->points.push_back(point);
+      p_stats->point_ipc.push_back(1.0 / cpi);
+      return true;
+    }
+    --p_cluster->intervals;
+  }
+  return false;
+}
+
+/**
+ * @brief Function which computes the sample variance of the CPIs of a cluster.
+ *
+ * @param cluster       Cluster.
+ */
+static double
+cluster_spread(
+  const cluster_sample_t& cluster
+)
+{
+  const std::vector<double>& cpis = cluster.cpis;
+  double mean = 0.0;
+  for (size_t i = 0; i < cpis.size(); ++i) {
+    mean += cpis[i] / cpis.size();
+  }
+  double spread = 0.0;
+  for (size_t i = 0; (cpis.size() > 1) && (i < cpis.size()); ++i) {
+    spread += (cpis[i] - mean) * (cpis[i] - mean) / (cpis.size() - 1);
+  }
+  return spread;
+}
+
+/**
+ * @brief Function which estimates the IPC of the whole trace from the points
+ *        simulated so far. The CPI of a cluster is the mean over its points, and
+ *        the spread between the points of a cluster gives the error estimate,
+ *        the points being a stratified random sample with the clusters as strata.
+ *        The variance of a cluster shrinks with the fraction of its intervals
+ *        simulated, so that a cluster simulated whole has no sampling error.
+ *        With a few points per cluster the interval uses Student's t distribution,
+ *        with the degrees of freedom of the pooled variance (Welch-Satterthwaite).
+ *        A cluster sampled with a single point of several has an unknown error,
+ *        and then no interval is given.
+ *
+ * @param clusters      Clusters with the CPIs of their simulated points.
+ * @param p_stats       Pointer to the structure in which the estimate is returned.
+ */
+static void
+estimate_ipc(
+  const std::vector<cluster_sample_t>& clusters,
+  simpoint_stats_t* const p_stats
+)
+{
+  double cpi = 0.0;
+  double variance = 0.0;
+  double totalWeight = 0.0;
+  // denominator of the degrees of freedom of the variance
+  double dfTerms = 0.0;
+  bool unknownError = false;
+  for (std::vector<cluster_sample_t>::const_iterator c = clusters.begin(); c != clusters.end(); ++c) {
+    const size_t n = c->cpis.size();
+    if (n == 0) {
+      continue;
+    }
+    double mean = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      mean += c->cpis[i] / n;
+    }
+    cpi += c->weight * mean;
+    totalWeight += c->weight;
+    const double unsampled = 1.0 - static_cast<double>(n) / std::max(c->intervals, n);
+    if (unsampled <= 0.0) {
+      continue;
+    }
+    if (n > 1) {
+      double stratum = c->weight * c->weight * unsampled * cluster_spread(*c) / n;
+      variance += stratum;
+      dfTerms += stratum * stratum / (n - 1);
+    }
+    else {
+      unknownError = true;
+    }
+  }
+  // normalize in case only some of the clusters were simulated
+  if (totalWeight > 0.0) {
+    cpi /= totalWeight;
+    variance /= (totalWeight * totalWeight);
+    dfTerms /= (totalWeight * totalWeight * totalWeight * totalWeight);
+  }
+  double quantile = 1.96;
+  if (dfTerms > 0.0) {
+    double df = variance * variance / dfTerms;
+    size_t entries = sizeof(studentT975) / sizeof(studentT975[0]);
+    if (df < entries) {
+      // rounding the degrees of freedom down keeps the interval conservative
+      quantile = studentT975[static_cast<size_t>(std::max(df, 1.0)) - 1];
+    }
+  }
+  p_stats->ipc = (cpi > 0.0) ? (1.0 / cpi) : 0.0;
+  // error of the IPC follows from the error of the CPI, IPC being its reciprocal, negative if unknown
+  p_stats->ipc_error = unknownError ? -1.0 : ((cpi > 0.0) ? (quantile * std::sqrt(variance) / (cpi * cpi)) : 0.0);
+}
+
+/**
+ * @brief Function which simulates only simulation points of a trace and
+ *        estimates the IPC of the whole trace from them. The first
+ *        SIMPOINT_POINTS_PER_CLUSTER points of every cluster are simulated, then
+ *        as many more as the spreads of the clusters ask for to bring the error
+ *        within the target, each going to the cluster in which it reduces the
+ *        variance the most, again until the error is within the target or the
+ *        points run out.
+ *
+ * @param config        Configuration of the processor.
+ * @param trace         Trace to be simulated.
+ * @param intervalSize  Number of instructions in an interval.
+ * @param warmup        Number of instructions simulated before every point.
+ * @param points        Simulation points, those of every cluster in draw order.
+ * @param targetError   Half width of the 95% confidence interval relative to the IPC to stop at.
+ * @param p_stats       Pointer to the structure in which the estimate is returned.
+ */
+void
+simulate_simpoints(
+  const sweep_config_t& config,
+  const TraceBuffer& trace,
+  const uint64_t intervalSize,
+  const uint64_t warmup,
+  const std::vector<simpoint_t>& points,
+  const double targetError,
+  simpoint_stats_t* const p_stats
+)
+{
+  std::map<uint32_t, size_t> clusterIndex;
+  std::vector<cluster_sample_t> clusters;
+  for (std::vector<simpoint_t>::const_iterator p = points.begin(); p != points.end(); ++p) {
+    if (clusterIndex.find(p->cluster) == clusterIndex.end()) {
+      clusterIndex[p->cluster] = clusters.size();
+      cluster_sample_t cluster = {p->weight, std::vector<simpoint_t>(), 0, 0, std::vector<double>()};
+      clusters.push_back(cluster);
+    }
+    cluster_sample_t& cluster = clusters[clusterIndex[p->cluster]];
+    cluster.points.push_back(*p);
+  }
+  // a file listing only some of the intervals of a cluster still samples all of them
+  for (std::vector<cluster_sample_t>::iterator c = clusters.begin(); c != clusters.end(); ++c) {
+    size_t weighted = static_cast<size_t>(c->weight * trace.size() / intervalSize + 0.5);
+    c->intervals = std::max(c->points.size(), weighted);
+  }
+
+  p_stats->points.clear();
+  p_stats->point_ipc.clear();
+  for (std::vector<cluster_sample_t>::iterator c = clusters.begin(); c != clusters.end(); ++c) {
+    while ((c->cpis.size() < SIMPOINT_POINTS_PER_CLUSTER) &&
+           draw_point(config, trace, intervalSize, warmup, &(*c), p_stats));
+  }
+  estimate_ipc(clusters, p_stats);
+
+  while ((p_stats->ipc_error < 0.0) || (p_stats->ipc_error > targetError * p_stats->ipc)) {
+    // plan all the points needed at the current spreads before estimating again, as
+    // stopping at the first estimate within the target would favor samples whose
+    // spread happens to be low
+    std::vector<size_t> planned(clusters.size(), 0);
+    std::vector<double> spreads(clusters.size(), 0.0);
+    double variance = 0.0;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+      const size_t n = clusters[c].cpis.size();
+      spreads[c] = cluster_spread(clusters[c]);
+      if (n > 1) {
+        double unsampled = 1.0 / n - 1.0 / std::max(clusters[c].intervals, n);
+        variance += clusters[c].weight * clusters[c].weight * spreads[c] * std::max(unsampled, 0.0);
+      }
+      else if ((p_stats->ipc_error < 0.0) && (clusters[c].drawn < clusters[c].points.size())) {
+        // a second point makes the error of the cluster known
+        planned[c] = 1;
+      }
+    }
+    // the error shrinks with the square root of the variance
+    double ratio = targetError * p_stats->ipc / p_stats->ipc_error;
+    const double required = (p_stats->ipc_error > 0.0) ? (variance * ratio * ratio) : variance;
+    while (variance > required) {
+      // the next point goes where it reduces the variance the most, w^2 s^2 / (n (n + 1))
+      size_t next = clusters.size();
+      double best = 0.0;
+      for (size_t c = 0; c < clusters.size(); ++c) {
+        const size_t n = clusters[c].cpis.size() + planned[c];
+        if ((n < 2) || (clusters[c].drawn + planned[c] >= clusters[c].points.size())) {
+          continue;
+        }
+        double gain = clusters[c].weight * clusters[c].weight * spreads[c] / (n * (n + 1));
+        if (gain > best) {
+          best = gain;
+          next = c;
+        }
+      }
+      if (next == clusters.size()) {
+        break;
+      }
+      ++planned[next];
+      variance -= best;
+    }
+
+    size_t drawn = 0;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+      for (size_t i = 0; (i < planned[c]) && draw_point(config, trace, intervalSize, warmup, &clusters[c], p_stats); ++i) {
+        ++drawn;
+      }
+    }
+    if (drawn == 0) {
+      break;
+    }
+    estimate_ipc(clusters, p_stats);
+  }
+}
@@ -0,0 +1,62 @@
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+# phased synthetic traces, with the IPC of every interval far from that of the whole trace
+SEEDS = range(1, 11)
+# a 95% confidence interval misses the IPC of the full run for 1 trace in 20,
+# more than 2 misses in 10 traces happen by chance for less than 2% of the seeds
+MAX_MISSES = 2
+INSTRUCTIONS = 200000
+PHASE = 7400
+INTERVAL = 2000
+TARGET_ERROR = 0.05
+
+def run(args):
+  return subprocess.check_output(args).decode()
+
+def getFieldValue(output, fieldStr):
+  indexStart = output.rfind(fieldStr) + len(fieldStr)
+  indexEnd = output.find('\n', indexStart)
+  return output[indexStart:indexEnd]
+
+def main():
+  bin = os.path.dirname(os.path.abspath(__file__))
+  tmp = tempfile.mkdtemp()
+  failures = 0
+  misses = 0
+  try:
+    print('SEED\tFULL IPC\tESTIMATE\tERROR\tPOINTS')
+    for seed in SEEDS:
+      trace = os.path.join(tmp, 'phased%d.bin' % seed)
+      points = os.path.join(tmp, 'phased%d.simpoints' % seed)
+      run([os.path.join(bin, 'trace_gen'), '-b', '-o', trace, '-n', str(INSTRUCTIONS), '-p', str(PHASE), '-P', '8', '-s', str(seed)])
+      run([os.path.join(bin, 'simpoint'), '-i', trace, '-o', points, '-n', str(INTERVAL), '-s', str(seed)])
+      full = float(getFieldValue(run([os.path.join(bin, 'procsim'), '-i', trace, '--no-cycle-log']), 'Avg inst retired per cycle: '))
+      output = run([os.path.join(bin, 'procsim'), '-i', trace, '--simpoints', points, '--simpoint-error', str(TARGET_ERROR)])
+      estimate = float(getFieldValue(output, 'Estimated inst retired per cycle: '))
+      error = getFieldValue(output, 'Estimate error (95% confidence): ')
+      simulated = len([l for l in output.split('Simulation points:\n')[1].split('\n\n')[0].split('\n')[1:] if l])
+      # the interval must be known and as narrow as asked, and should hold the IPC of the full run
+      if error.startswith('unknown') or float(error) > TARGET_ERROR * estimate:
+        failures += 1
+        flag = 'FAILED'
+      elif abs(estimate - full) > float(error):
+        misses += 1
+        flag = 'MISSED'
+      else:
+        flag = ''
+      print('%d\t%f\t%f\t%s\t%d\t%s' % (seed, full, estimate, error, simulated, flag))
+  finally:
+    shutil.rmtree(tmp)
+
+  if failures > 0 or misses > MAX_MISSES:
+    print('%d of %d estimates failed, %d missed the full run IPC' % (failures, len(SEEDS), misses))
+    return 1
+  print('%d of %d estimates within %.0f%% hold the full run IPC' % (len(SEEDS) - misses, len(SEEDS), 100.0 * TARGET_ERROR))
+  return 0
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,352 @@
+#include "sweep.hpp"
+
+#include "batch.hpp"
+#include "dataflow.hpp"
+#include "processor.hpp"
+#include "result_cache.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+// ranges of the parameters, same as the ones in run_experiments.py
+static const uint64_t rangeR[] = {1, 2, 3, 4, 5, 6, 7, 8};
+static const uint64_t rangeF[] = {4, 8};
+static const uint64_t rangeK[] = {1, 2};
+
+/**
+ * @brief Function which lists all the configurations of the sweep, in the
+ *        order in which they are written out.
+ */
+std::vector<sweep_config_t>
+sweep_configurations(
+)
+{
+  std::vector<sweep_config_t> configs;
+  for (size_t r = 0; r < sizeof(rangeR) / sizeof(uint64_t); ++r) {
+    for (size_t f = 0; f < sizeof(rangeF) / sizeof(uint64_t); ++f) {
+      for (size_t j = 0; j < sizeof(rangeK) / sizeof(uint64_t); ++j) {
+        for (size_t k = 0; k < sizeof(rangeK) / sizeof(uint64_t); ++k) {
+          for (size_t l = 0; l < sizeof(rangeK) / sizeof(uint64_t); ++l) {
+            sweep_config_t config = {rangeR[r], rangeF[f], {rangeK[j], rangeK[k], rangeK[l]}};
+            configs.push_back(config);
+          }
+        }
+      }
+    }
+  }
+  return configs;
+}
+
+/**
+ * @brief Function which replaces the IPC and the cycles of a run which stopped
+ *        early by their estimates for the whole trace, so that its row of the
+ *        sweep can be compared with the others.
+ *
+ * @param estimate  Estimate of the run.
+ * @param trace     Trace which was simulated.
+ * @param p_stats   Pointer to the statistics structure of the run.
+ */
+static void
+apply_estimate(
+  const convergence_t& estimate,
+  const TraceBuffer& trace,
+  proc_stats_t* const p_stats
+)
+{
+  if ((estimate.instructions < trace.size()) && (estimate.ipc > 0.0)) {
+    p_stats->avg_inst_retired = estimate.ipc;
+    p_stats->cycle_count = static_cast<unsigned long>(llround(trace.size() / estimate.ipc));
+  }
+}
+
+/**
+ * @brief Function which simulates one configuration on an already loaded trace.
+ *
+ * @param config        Configuration to be simulated.
+ * @param trace         Trace to be simulated.
+ * @param p_stats       Pointer to the statistics structure to populate.
+ * @param convergence   Settings for stopping once the IPC has converged, or
+ *                      NULL to simulate the whole trace.
+ * @param p_estimate    Pointer to the estimate to populate when stopping early.
+ */
+void
+simulate_configuration(
+  const sweep_config_t& config,
+  const TraceBuffer& trace,
+  proc_stats_t* const p_stats,
+  const convergence_params_t* const convergence,
+  convergence_t* const p_estimate
+)
+{
+  // only the overall statistics are of interest in a sweep, the cycle log stays disabled
+  Processor processor(config.r, config.k, config.f);
+  processor.setTrace(trace.begin(), trace.end());
+  if (convergence == NULL) {
+    processor.run();
+    *p_stats = processor.statistics();
+    return;
+  }
+  processor.runUntilConverged(*convergence, p_estimate);
+  *p_stats = processor.statistics();
+  apply_estimate(*p_estimate, trace, p_stats);
+}
+
+/**
+ * @brief Function which submits the simulation of some configurations of a
+ *        trace to a thread pool, one batch for every distinct machine, so that
+ *        the configurations of the same machine are simulated once.
+ *
+ * @param pool        Thread pool running the simulations.
+ * @param configs     All the configurations of the sweep.
+ * @param indices     Indices of the configurations to be simulated.
+ * @param trace       Trace to be simulated.
+ * @param convergence Settings for stopping once the IPC has converged, or NULL.
+ * @param p_results   Pointer to the statistics of all the configurations, the
+ *                    simulated ones are populated once the pool is done.
+ * @param p_estimates Pointer to the estimates of all the configurations,
+ *                    populated as well when stopping early.
+ */
+static void
+submit_configurations(
+  ThreadPool& pool,
+  const std::vector<sweep_config_t>& configs,
+  const std::vector<size_t>& indices,
+  const TraceBuffer* const trace,
+  const convergence_params_t* const convergence,
+  std::vector<proc_stats_t>* const p_results,
+  std::vector<convergence_t>* const p_estimates
+)
+{
+  std::vector<std::vector<size_t> > batches;
+  std::vector<sweep_config_t> machines;
+  for (std::vector<size_t>::const_iterator i = indices.begin(); i != indices.end(); ++i) {
+    sweep_config_t machine = machine_configuration(configs[*i]);
+    size_t b = 0;
+    while ((b < machines.size()) && (memcmp(&machines[b], &machine, sizeof(sweep_config_t)) != 0)) {
+      ++b;
+    }
+    if (b == machines.size()) {
+      machines.push_back(machine);
+      batches.push_back(std::vector<size_t>());
+    }
+    batches[b].push_back(*i);
+  }
+
+  for (std::vector<std::vector<size_t> >::const_iterator b = batches.begin(); b != batches.end(); ++b) {
+    const std::vector<size_t> batchIndices = *b;
+    std::vector<sweep_config_t> batch;
+    for (std::vector<size_t>::const_iterator c = batchIndices.begin(); c != batchIndices.end(); ++c) {
+      batch.push_back(configs[*c]);
+    }
+    pool.submit([batch, batchIndices, trace, convergence, p_results, p_estimates]() {
+      std::vector<proc_stats_t> stats;
+      std::vector<convergence_t> estimates;
+      BatchSimulator(batch, *trace).simulate(stats, convergence, &estimates);
+      for (size_t c = 0; c < batchIndices.size(); ++c) {
+        if (convergence != NULL) {
+          (*p_estimates)[batchIndices[c]] = estimates[c];
+        }
+        (*p_results)[batchIndices[c]] = stats[c];
+      }
+    });
+  }
+}
+
+/**
+ * @brief Function which runs the sweep over all the configurations for all
+ *        the given traces, and writes the results for every trace to a file
+ *        named after the trace, in the same format as run_experiments.py.
+ *
+ * @param traceFiles  Names of the trace files.
+ * @param numThreads  Number of threads to be used for simulation.
+ * @param tolerance   Fraction of the dataflow limit of a trace a configuration
+ *                    has to reach for the larger ones to be skipped, with their
+ *                    rows left out of the results, or a negative value to
+ *                    simulate all the configurations.
+ * @param convergence Settings for stopping every configuration once its IPC
+ *                    has converged, with the IPC and the cycles of its row
+ *                    estimated for the whole trace, or NULL to simulate the
+ *                    whole trace for every configuration. Every row then ends
+ *                    with a flag which is 1 if the row is an estimate, whose
+ *                    dispatch queue sizes only cover the simulated instructions.
+ * @param cacheName   Name of the file caching the results of whole trace
+ *                    simulations across runs, which are looked up before
+ *                    simulating and written back afterwards, or NULL.
+ *
+ * @return  true if all the traces were simulated and written.
+ */
+bool
+run_sweep(
+  const std::vector<std::string>& traceFiles,
+  const unsigned numThreads,
+  const double tolerance,
+  const convergence_params_t* const convergence,
+  const char* const cacheName
+)
+{
+  const std::vector<sweep_config_t> configs = sweep_configurations();
+
+  // every trace is parsed once and shared by all its configurations
+  std::vector<std::unique_ptr<TraceBuffer> > traces;
+  for (std::vector<std::string>::const_iterator t = traceFiles.begin(); t != traceFiles.end(); ++t) {
+    traces.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer()));
+    if (!traces.back()->load(t->c_str())) {
+      fprintf(stderr, "Failed to load trace %s\n", t->c_str());
+      return false;
+    }
+  }
+
+  std::vector<std::vector<proc_stats_t> > results(traces.size(), std::vector<proc_stats_t>(configs.size()));
+  // simulated IPC of every configuration of every trace, negative until it is simulated
+  std::vector<std::vector<double> > ipc(traces.size(), std::vector<double>(configs.size(), -1.0));
+  std::vector<std::vector<convergence_t> > estimates(traces.size(), std::vector<convergence_t>(configs.size()));
+  // pruned configurations are left out of the results
+  std::vector<std::vector<bool> > pruned(traces.size(), std::vector<bool>(configs.size(), false));
+
+  // configurations found in the result cache are not simulated again
+  std::vector<uint64_t> traceHashes(traces.size(), 0);
+  std::vector<std::vector<bool> > cached(traces.size(), std::vector<bool>(configs.size(), false));
+  if (cacheName != NULL) {
+    ResultCache cache;
+    if (!cache.open(cacheName)) {
+      fprintf(stderr, "Failed to open result cache %s\n", cacheName);
+      return false;
+    }
+    for (size_t t = 0; t < traces.size(); ++t) {
+      traceHashes[t] = hash_trace(traces[t]->begin(), traces[t]->end());
+      for (size_t c = 0; c < configs.size(); ++c) {
+        if (cache.lookup(result_cache_key(traceHashes[t], traces[t]->size(), configs[c]), &results[t][c])) {
+          cached[t][c] = true;
+          ipc[t][c] = results[t][c].avg_inst_retired;
+        }
+      }
+      fprintf(stderr, "%s: found %zu of %zu configurations in the result cache\n", traceFiles[t].c_str(),
+              static_cast<size_t>(std::count(cached[t].begin(), cached[t].end(), true)), configs.size());
+    }
+  }
+
+  {
+    ThreadPool pool(numThreads);
+    if (tolerance >= 0.0) {
+      std::vector<dataflow_stats_t> dataflow(traces.size());
+      std::vector<std::vector<double> > limits(traces.size());
+      for (size_t t = 0; t < traces.size(); ++t) {
+        analyze_dataflow(traces[t]->begin(), traces[t]->end(), NULL, &dataflow[t]);
+        limits[t] = configuration_ipc_limits(traces[t]->begin(), traces[t]->end(), dataflow[t], configs);
+      }
+      // grow the configurations which could reach the limits of larger ones from
+      // the smallest ones, until every larger one is known to be reached or is simulated
+      for (bool more = true; more;) {
+        more = false;
+        std::vector<std::vector<size_t> > next(traces.size());
+        for (size_t t = 0; t < traces.size(); ++t) {
+          std::vector<bool> flags = next_configurations(limits[t], configs, ipc[t], tolerance);
+          for (size_t c = 0; c < configs.size(); ++c) {
+            if (flags[c]) {
+              next[t].push_back(c);
+            }
+          }
+          submit_configurations(pool, configs, next[t], traces[t].get(), convergence, &results[t], &estimates[t]);
+          more = more || !next[t].empty();
+        }
+        pool.wait();
+        for (size_t t = 0; t < traces.size(); ++t) {
+          for (std::vector<size_t>::const_iterator c = next[t].begin(); c != next[t].end(); ++c) {
+            ipc[t][*c] = results[t][*c].avg_inst_retired;
+          }
+        }
+      }
+      for (size_t t = 0; t < traces.size(); ++t) {
+        pruned[t] = prune_configurations(limits[t], configs, ipc[t], tolerance);
+        // the rows of cached configurations cost nothing, so they are always written
+        for (size_t c = 0; c < configs.size(); ++c) {
+          pruned[t][c] = pruned[t][c] && !cached[t][c];
+        }
+        fprintf(stderr, "%s: dataflow IPC limit %f, pruned %zu of %zu configurations\n", traceFiles[t].c_str(),
+                dataflow[t].ipc_limit, static_cast<size_t>(std::count(pruned[t].begin(), pruned[t].end(), true)),
+                configs.size());
+      }
+    }
+
+    for (size_t t = 0; t < traces.size(); ++t) {
+      std::vector<size_t> remaining;
+      for (size_t c = 0; c < configs.size(); ++c) {
+        if ((ipc[t][c] < 0.0) && !pruned[t][c]) {
+          remaining.push_back(c);
+        }
+      }
+      submit_configurations(pool, configs, remaining, traces[t].get(), convergence, &results[t], &estimates[t]);
+    }
+    pool.wait();
+  }
+
+  for (size_t t = 0; (convergence != NULL) && (t < traces.size()); ++t) {
+    size_t stopped = 0;
+    uint64_t instructions = 0;
+    uint64_t total = 0;
+    double error = 0.0;
+    for (size_t c = 0; c < configs.size(); ++c) {
+      if (pruned[t][c] || cached[t][c]) {
+        continue;
+      }
+      const convergence_t& estimate = estimates[t][c];
+      if (estimate.instructions < traces[t]->size()) {
+        ++stopped;
+        error = std::max(error, estimate.error / estimate.ipc);
+      }
+      instructions += estimate.instructions;
+      total += traces[t]->size();
+    }
+    fprintf(stderr, "%s: stopped %zu configurations early, simulated %.1f%% of the instructions, largest error %.2f%%\n",
+            traceFiles[t].c_str(), stopped, (total > 0) ? (100.0 * instructions / total) : 0.0, 100.0 * error);
+  }
+
+  // only whole trace simulations are cached, estimates of runs which stopped early are not
+  if ((cacheName != NULL) && (convergence == NULL)) {
+    ResultCache cache;
+    bool stored = cache.open(cacheName);
+    for (size_t t = 0; stored && (t < traces.size()); ++t) {
+      for (size_t c = 0; stored && (c < configs.size()); ++c) {
+        if (!cached[t][c] && !pruned[t][c]) {
+          stored = cache.insert(result_cache_key(traceHashes[t], traces[t]->size(), configs[c]), results[t][c]);
+        }
+      }
+    }
+    if (!stored) {
+      fprintf(stderr, "Failed to write results to the result cache %s\n", cacheName);
+    }
+  }
+
+  for (size_t t = 0; t < traces.size(); ++t) {
+    // name the output after the trace, without its directory and extension
+    std::string name = traceFiles[t].substr(traceFiles[t].find_last_of('/') + 1);
+    name = name.substr(0, name.find_last_of('.')) + ".txt";
+    FILE* of = fopen(name.c_str(), "w");
+    if (of == NULL) {
+      fprintf(stderr, "Failed to open %s for writing\n", name.c_str());
+      return false;
+    }
+    for (size_t c = 0; c < configs.size(); ++c) {
+      if (pruned[t][c]) {
+        continue;
+      }
+      const sweep_config_t& config = configs[c];
+      const proc_stats_t& stats = results[t][c];
+      fprintf(of, "%" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 ",\t%f, %lu, %f, %lu",
+              config.r, config.f, config.k[0], config.k[1], config.k[2],
+              stats.avg_disp_size, stats.max_disp_size, stats.avg_inst_retired, stats.cycle_count);
+      if (convergence != NULL) {
+        // results of runs which stopped early are flagged, cached results are of whole runs
+        bool estimated = !cached[t][c] && (estimates[t][c].instructions < traces[t]->size());
+        fprintf(of, ", %d", estimated ? 1 : 0);
+      }
+      fprintf(of, "\n");
+    }
+    fclose(of);
+  }
+  return true;
+}
@@ -0,0 +1,26 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include "tomasulo.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Struct for storing one point of the design space.
+ */
+typedef struct _sweep_config_t {
+  uint64_t r;
+  uint64_t f;
+  uint64_t k[NUM_FU_TYPES];
+} sweep_config_t;
+
+std::vector<sweep_config_t> sweep_configurations();
+
+void simulate_configuration(const sweep_config_t&, const TraceBuffer&, proc_stats_t* const,
+                            const convergence_params_t* const = NULL, convergence_t* const = NULL);
+
+bool run_sweep(const std::vector<std::string>&, const unsigned, const double,
+               const convergence_params_t* const, const char* const = NULL);
+
+#endif /* SWEEP_HPP */
@@ -0,0 +1,150 @@
+#include "thread_pool.hpp"
+
+/**
+ * @brief Constructor which starts the worker threads.
+ *
+ * @param numThreads  Number of worker threads, at least one is always started.
+ */
+ThreadPool::ThreadPool(
+  const unsigned numThreads
+) : m_queues(),
+  m_threads(),
+  m_mutex(),
+  m_taskAvailable(),
+  m_allDone(),
+  m_queuedTasks(0),
+  m_pendingTasks(0),
+  m_nextQueue(0),
+  m_stopping(false)
+{
+  unsigned n = (numThreads > 0) ? numThreads : 1;
+  for (unsigned i = 0; i < n; ++i) {
+    m_queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+  }
+  for (unsigned i = 0; i < n; ++i) {
+    m_threads.push_back(std::thread(&ThreadPool::work, this, i));
+  }
+}
+
+/**
+ * @brief Destructor which finishes all the submitted tasks and joins the workers.
+ */
+ThreadPool::~ThreadPool(
+)
+{
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_taskAvailable.notify_all();
+  for (std::vector<std::thread>::iterator t = m_threads.begin(); t != m_threads.end(); ++t) {
+    t->join();
+  }
+}
+
+/**
+ * @brief Function which submits a task, the tasks are spread over the worker queues.
+ *
+ * @param task  Task to be executed by one of the workers.
+ */
+void
+ThreadPool::submit(
+  const std::function<void()>& task
+)
+{
+  unsigned q;
+  {
+    // count the task before it is visible in a queue, a worker may take it at once
+    std::lock_guard<std::mutex> lock(m_mutex);
+    q = m_nextQueue;
+    m_nextQueue = (m_nextQueue + 1) % m_queues.size();
+    ++m_queuedTasks;
+    ++m_pendingTasks;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+    m_queues[q]->tasks.push_back(task);
+  }
+  m_taskAvailable.notify_one();
+}
+
+/**
+ * @brief Function which blocks until all the submitted tasks have finished.
+ */
+void
+ThreadPool::wait(
+)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (m_pendingTasks > 0) {
+    m_allDone.wait(lock);
+  }
+}
+
+/**
+ * @brief Function which takes a task for a worker, from the back of its own
+ *        queue if possible, otherwise from the front of another queue.
+ *
+ * @param id    Index of the worker.
+ * @param task  Variable in which the task is returned.
+ *
+ * @return  true if a task was found.
+ */
+bool
+ThreadPool::takeTask(
+  const unsigned id,
+  std::function<void()>& task
+)
+{
+  for (unsigned i = 0; i < m_queues.size(); ++i) {
+    WorkerQueue& queue = *m_queues[(id + i) % m_queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      if (i == 0) {
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+      }
+      else {
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Function which is run by every worker thread.
+ *
+ * @param id    Index of the worker.
+ */
+void
+ThreadPool::work(
+  const unsigned id
+)
+{
+  while (true) {
+    std::function<void()> task;
+    if (takeTask(id, task)) {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_queuedTasks;
+      }
+      task();
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_pendingTasks == 0) {
+        m_allDone.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping && (m_queuedTasks == 0)) {
+      m_taskAvailable.wait(lock);
+    }
+    if (m_stopping && (m_queuedTasks == 0)) {
+      return;
+    }
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Pool of worker threads, each with its own task deque. Workers take
+ *        tasks from the back of their own deque and steal from the front of
+ *        the others when they run out of work.
+ */
+class ThreadPool {
+public:
+  explicit ThreadPool(const unsigned);
+
+  ~ThreadPool();
+
+  void submit(const std::function<void()>&);
+
+  void wait();
+
+  unsigned size() const { return static_cast<unsigned>(m_threads.size()); }
+
+private:
+  /**
+   * @brief Deque of tasks owned by one worker.
+   */
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()> > tasks;
+  };
+
+  ThreadPool(const ThreadPool&);
+
+  ThreadPool& operator=(const ThreadPool&);
+
+  void work(const unsigned);
+
+  bool takeTask(const unsigned, std::function<void()>&);
+
+private:
+  std::vector<std::unique_ptr<WorkerQueue> > m_queues;
+
+  std::vector<std::thread> m_threads;
+
+  // protects the counters below and guards waiting on the condition variables
+  std::mutex m_mutex;
+  std::condition_variable m_taskAvailable;
+  std::condition_variable m_allDone;
+
+  // tasks which have been submitted but not taken by any worker
+  unsigned long m_queuedTasks;
+  // tasks which have been submitted but not finished
+  unsigned long m_pendingTasks;
+
+  unsigned m_nextQueue;
+
+  bool m_stopping;
+};
+
+#endif /* THREAD_POOL_HPP */
@@ -1,31 +1,119 @@
 #include "tomasulo.hpp"
 
+#include "checkpoint.hpp"
+#include "instruction_source.hpp"
+
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 
-// set this to 1 for printing out what happens in each cycle to stderr
-#define DEBUG_LOG 0
+// seed of the generator used by the random select policy, so that runs can be repeated
+#define SELECT_RANDOM_SEED 0x9e3779b97f4a7c15ULL
+
+// names of the select policies, indexed by select_policy_t
+static const char* const selectPolicyNames[NUM_SELECT_POLICIES] = {"oldest", "longest-chain", "most-dependents", "random"};
+
+// names of the fetch policies, indexed by fetch_policy_t
+static const char* const fetchPolicyNames[NUM_FETCH_POLICIES] = {"round-robin", "icount"};
+
+/**
+ * @brief Function which finds a select policy by its name.
+ *
+ * @param name      Name of the policy: oldest, longest-chain, most-dependents or random.
+ * @param p_policy  Pointer to the policy to populate.
+ *
+ * @return  true if the name is known.
+ */
+bool
+parse_select_policy(
+  const char* const name,
+  select_policy_t* const p_policy
+)
+{
+  for (int p = 0; p < NUM_SELECT_POLICIES; ++p) {
+    if (strcmp(name, selectPolicyNames[p]) == 0) {
+      *p_policy = static_cast<select_policy_t>(p);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Function which finds a fetch policy by its name.
+ *
+ * @param name      Name of the policy: round-robin or icount.
+ * @param p_policy  Pointer to the policy to populate.
+ *
+ * @return  true if the name is known.
+ */
+bool
+parse_fetch_policy(
+  const char* const name,
+  fetch_policy_t* const p_policy
+)
+{
+  for (int p = 0; p < NUM_FETCH_POLICIES; ++p) {
+    if (strcmp(name, fetchPolicyNames[p]) == 0) {
+      *p_policy = static_cast<fetch_policy_t>(p);
+      return true;
+    }
+  }
+  return false;
+}
 
 /**
  * @brief Default constructor for the simulator class.
  */
 TomasuloSimulator::TomasuloSimulator(
 ) : m_schedulingQueue(),
+  m_histograms(),
   m_instructionCycleLog(0),
   m_waitingInstructions(0),
+  m_executedInstructions(0),
+  m_issuePolicy(SELECT_OLDEST),
+  m_busPolicy(SELECT_OLDEST),
+  m_randomState(SELECT_RANDOM_SEED),
+  m_candidates(),
+  m_reordered(),
+  m_chainStack(),
   m_resultBuses(0),
   m_scoreboard(),
+  m_executing(),
   m_regFile(),
-  m_dispatchQueue(),
+  m_threads(1),
+  m_fetchPolicy(FETCH_ROUND_ROBIN),
+  m_fetchThread(0),
+  m_dispatchQueueCount(0),
+  m_dispatchQueueCapacity(UNBOUNDED_DISPATCH_QUEUE),
+  m_dispatchWidth(0),
+  m_dispatchWidthLimited(false),
+  m_numFUs(),
+  m_latency(),
+  m_initiationInterval(),
+  m_unitCapacity(),
   m_schedulingQueueCapacity(0),
   m_fetchRate(0),
+  m_issueWidth(0),
   m_reservedSlots(0),
+  m_broadcastBuses(0),
+  m_waitingToSchedule(0),
   m_dispatchQueueSize(0),
   m_firedInstruction(0),
   m_retiredInstruction(0),
   m_counter(0),
+  m_loggedInstruction(0),
+  m_cycleLogMask(0),
+  m_cycleLogSink(NULL),
+  m_debugSink(NULL),
+  m_cycleLogStarted(false),
   m_doneFetching(true)
 {
+  m_numFUs.fill(0);
+  m_latency.fill(1);
+  m_initiationInterval.fill(1);
+  m_unitCapacity.fill(1);
+  allocateCycleLog();
 }
 
 /**
@@ -40,67 +128,461 @@ TomasuloSimulator::TomasuloSimulator(
   const uint64_t k[NUM_FU_TYPES],
   const uint64_t f
 ) : m_schedulingQueue(),
+  m_histograms(),
   m_instructionCycleLog(0),
   m_waitingInstructions(0),
+  m_executedInstructions(0),
+  m_issuePolicy(SELECT_OLDEST),
+  m_busPolicy(SELECT_OLDEST),
+  m_randomState(SELECT_RANDOM_SEED),
+  m_candidates(),
+  m_reordered(),
+  m_chainStack(),
   m_resultBuses(r),
   m_scoreboard(),
+  m_executing(),
   m_regFile(),
-  m_dispatchQueue(),
+  m_threads(1),
+  m_fetchPolicy(FETCH_ROUND_ROBIN),
+  m_fetchThread(0),
+  m_dispatchQueueCount(0),
+  m_dispatchQueueCapacity(UNBOUNDED_DISPATCH_QUEUE),
+  m_dispatchWidth(0),
+  m_dispatchWidthLimited(false),
+  m_numFUs(),
+  m_latency(),
+  m_initiationInterval(),
+  m_unitCapacity(),
   m_schedulingQueueCapacity(0),
   m_fetchRate(f),
+  m_issueWidth(0),
   m_reservedSlots(0),
+  m_broadcastBuses(0),
+  m_waitingToSchedule(0),
   m_dispatchQueueSize(0),
   m_firedInstruction(0),
+  m_retiredInstruction(0),
   m_counter(0),
+  m_loggedInstruction(0),
+  m_cycleLogMask(0),
+  m_cycleLogSink(NULL),
+  m_debugSink(NULL),
+  m_cycleLogStarted(false),
   m_doneFetching(false)
 {
   for (uint64_t i = 0; i < NUM_FU_TYPES; ++i) {
+    m_numFUs[i] = k[i];
     // scheduling capacity is twice the number of function units
     m_schedulingQueueCapacity += 2 * k[i];
-    for (uint64_t j = 0; j < k[i]; ++j) {
-      // initialize all the scoreboard slots to -1
-      m_scoreboard[i].push_back(-1);
-    }
+    // all the functional units are free initially
+    uint64_t units = std::min(k[i], static_cast<uint64_t>(MAX_FUS_PER_TYPE));
+    m_scoreboard[i].units = (units == MAX_FUS_PER_TYPE) ? ~static_cast<uint64_t>(0) : ((static_cast<uint64_t>(1) << units) - 1);
+    m_scoreboard[i].free = m_scoreboard[i].units;
+    m_scoreboard[i].waiting = 0;
+    m_scoreboard[i].in_flight.fill(0);
+    m_scoreboard[i].next_issue.fill(0);
+    m_issueWidth += units;
+    // units execute in one cycle, and are not pipelined, by default
+    m_latency[i] = 1;
+    m_initiationInterval[i] = 1;
+    m_unitCapacity[i] = 1;
   }
 
-  for (uint64_t i = 0; i < NUM_REGISTERS; ++i) {
+  for (uint64_t i = 0; i < m_regFile.size(); ++i) {
     // all the registers are ready initially
     m_regFile[i].first = true;
   }
+
+  // preallocate all the storage needed by the scheduling queue and execute stage
+  m_schedulingQueue = SchedulingQueue(m_schedulingQueueCapacity);
+  m_waitingInstructions.reserve(m_schedulingQueueCapacity);
+  m_executedInstructions.resize(m_schedulingQueueCapacity);
+  m_candidates.reserve(m_schedulingQueueCapacity);
+  m_reordered.reserve(m_schedulingQueueCapacity);
+
+  allocateCycleLog();
+}
+
+/**
+ * @brief Function which allocates the cycle log ring, or doubles it when the
+ *        instructions in flight do not fit in it anymore.
+ */
+void
+TomasuloSimulator::allocateCycleLog(
+)
+{
+  uint64_t size = m_instructionCycleLog.size();
+  if (size == 0) {
+    // start with a ring large enough for the scheduling queue and a few fetches
+    size = 1;
+    while (size < 2 * (m_schedulingQueueCapacity + m_fetchRate)) {
+      size <<= 1;
+    }
+  }
+  else {
+    size <<= 1;
+  }
+
+  std::vector<std::array<unsigned long, NUM_STAGES> > ring(size);
+  // move the logs of the instructions in flight to their new slots
+  for (uint32_t tag = m_loggedInstruction; tag != m_counter; ++tag) {
+    ring[tag & (size - 1)] = cycleLog(tag);
+  }
+  m_instructionCycleLog.swap(ring);
+  m_cycleLogMask = static_cast<uint32_t>(size - 1);
+}
+
+/**
+ * @brief Function which writes out the cycle logs of retired instructions,
+ *        in the order of their tags, and frees their slots in the ring.
+ */
+void
+TomasuloSimulator::writeRetiredCycles(
+)
+{
+  for (; m_loggedInstruction != m_counter; ++m_loggedInstruction) {
+    const std::array<unsigned long, NUM_STAGES>& instCycle = cycleLog(m_loggedInstruction);
+    // state update cycle is set only when the instruction retires
+    if (instCycle[4] == 0) {
+      break;
+    }
+    if (m_cycleLogSink == NULL) {
+      continue;
+    }
+    m_cycleLogSink->writeCycles(m_loggedInstruction + 1, instCycle.data());
+  }
 }
 
 /**
- * @brief Copy constructor. 
+ * @brief Function for fetching instructions directly from a memory mapped trace,
+ *        instead of reading them one by one from a source. Fetch resumes
+ *        after the instructions which have already been fetched, so a simulator
+ *        restored from a checkpoint continues where it left off.
  *
- * @param ts  The instance to be copied from.
+ * @param begin   Pointer to the first record of the trace.
+ * @param end     Pointer past the last record of the trace.
  */
-TomasuloSimulator::TomasuloSimulator(
-  const TomasuloSimulator& ts
+void
+TomasuloSimulator::setTrace(
+  const trace_record_t* const begin,
+  const trace_record_t* const end
 )
 {
-  // just copy all the values from the other instance
-  m_schedulingQueue = ts.m_schedulingQueue;
-  m_instructionCycleLog = ts.m_instructionCycleLog;
-  m_waitingInstructions = ts.m_waitingInstructions;
-  m_resultBuses = ts.m_resultBuses;
-  m_scoreboard = ts.m_scoreboard;
-  m_regFile = ts.m_regFile;
-  m_dispatchQueue = ts.m_dispatchQueue;
-  m_schedulingQueueCapacity = ts.m_schedulingQueueCapacity,
-  m_fetchRate = ts.m_fetchRate;
-  m_reservedSlots = ts.m_reservedSlots;
-  m_dispatchQueueSize = ts.m_dispatchQueueSize;
-  m_firedInstruction = ts.m_firedInstruction;
-  m_retiredInstruction = ts.m_retiredInstruction;
-  m_counter = ts.m_counter;
-  m_doneFetching = ts.m_doneFetching;
+  setThreadTrace(0, begin, end);
+}
 
+/**
+ * @brief Function for setting the source from which instructions are fetched.
+ *        The instructions which have already been fetched are skipped in the
+ *        source, so a simulator restored from a checkpoint continues where it
+ *        left off.
+ *
+ * @param source  Source of the instructions, which has to outlive the simulation.
+ */
+void
+TomasuloSimulator::setSource(
+  InstructionSource* const source
+)
+{
+  setThreadSource(0, source);
+}
+
+/**
+ * @brief Function which makes several hardware threads share the core. Each
+ *        thread fetches its own instructions into its own dispatch queue, and
+ *        one thread, picked by the fetch policy, fetches in every cycle. The
+ *        instructions of all the threads are dispatched oldest first, and share
+ *        the scheduling queue, the FUs and the result buses. Has to be called
+ *        before any instruction is fetched, a single thread is simulated by default.
+ *
+ * @param numThreads  Number of threads, up to MAX_SMT_THREADS.
+ * @param policy      Policy picking the thread which fetches in a cycle.
+ *
+ * @return  true if the number of threads is supported.
+ */
+bool
+TomasuloSimulator::setThreads(
+  const uint32_t numThreads,
+  const fetch_policy_t policy
+)
+{
+  if ((numThreads == 0) || (numThreads > MAX_SMT_THREADS) || (m_counter != 0)) {
+    return false;
+  }
+  m_threads.clear();
+  m_threads.resize(numThreads);
+  for (std::vector<thread_context_t>::iterator t = m_threads.begin(); t != m_threads.end(); ++t) {
+    t->dispatch_queue = DispatchQueue(m_dispatchQueueCapacity);
+  }
+  m_fetchPolicy = policy;
+  // the first thread fetches first
+  m_fetchThread = numThreads - 1;
+  return true;
+}
+
+/**
+ * @brief Function for making a thread fetch directly from a memory mapped trace.
+ *        Fetch resumes after the instructions the thread has already fetched.
+ *
+ * @param thread  Index of the thread.
+ * @param begin   Pointer to the first record of the trace.
+ * @param end     Pointer past the last record of the trace.
+ */
+void
+TomasuloSimulator::setThreadTrace(
+  const uint32_t thread,
+  const trace_record_t* const begin,
+  const trace_record_t* const end
+)
+{
+  thread_context_t& context = m_threads[thread];
+  context.trace_cursor = std::min(begin + context.fetched, end);
+  context.trace_end = end;
+  context.source = NULL;
+}
+
+/**
+ * @brief Function for setting the source from which a thread fetches. The
+ *        instructions the thread has already fetched are skipped in the source.
+ *
+ * @param thread  Index of the thread.
+ * @param source  Source of the instructions, which has to outlive the simulation.
+ */
+void
+TomasuloSimulator::setThreadSource(
+  const uint32_t thread,
+  InstructionSource* const source
+)
+{
+  thread_context_t& context = m_threads[thread];
+  context.trace_cursor = NULL;
+  context.trace_end = NULL;
+  context.source = source;
+  if (source != NULL) {
+    source->skip(context.fetched);
+  }
+}
+
+/**
+ * @brief Function for setting the timing of every type of functional units.
+ *        A unit accepts a new instruction every initiation interval cycles,
+ *        and its result is ready for a result bus latency cycles after it
+ *        starts executing. A unit keeps holding the instructions whose results
+ *        are waiting for a result bus, so it can hold at most latency divided
+ *        by initiation interval instructions, rounded up.
+ *
+ * @param latency   Array which specifies the latency of each type of units.
+ * @param interval  Array which specifies the initiation interval of each type of units.
+ */
+void
+TomasuloSimulator::setFUTiming(
+  const uint64_t latency[NUM_FU_TYPES],
+  const uint64_t interval[NUM_FU_TYPES]
+)
+{
   for (uint64_t i = 0; i < NUM_FU_TYPES; ++i) {
-    m_scoreboard[i] = ts.m_scoreboard[i];
+    m_latency[i] = std::max(latency[i], static_cast<uint64_t>(1));
+    m_initiationInterval[i] = std::max(interval[i], static_cast<uint64_t>(1));
+    m_unitCapacity[i] = (m_latency[i] + m_initiationInterval[i] - 1) / m_initiationInterval[i];
   }
-  for (uint64_t i = 0; i < NUM_REGISTERS; ++i) {
-    m_regFile[i] = ts.m_regFile[i];
+}
+
+/**
+ * @brief Function which sets the policies picking the instructions to fire on
+ *        the free FUs and the results to broadcast on the result buses. Both
+ *        pick the oldest instructions first by default.
+ *
+ * @param issuePolicy   Policy for firing ready instructions.
+ * @param busPolicy     Policy for granting the result buses.
+ */
+void
+TomasuloSimulator::setSelectPolicy(
+  const select_policy_t issuePolicy,
+  const select_policy_t busPolicy
+)
+{
+  m_issuePolicy = issuePolicy;
+  m_busPolicy = busPolicy;
+}
+
+/**
+ * @brief Function which limits the dispatch queue of every thread, fetch stops
+ *        for the cycle once the queue of the fetching thread is full, and the
+ *        number of instructions dispatched in a cycle. Both are unlimited by
+ *        default. Has to be called before any instruction is fetched.
+ *
+ * @param capacity  Capacity of the dispatch queue, or UNBOUNDED_DISPATCH_QUEUE.
+ * @param width     Number of instructions dispatched in a cycle, or 0 for no limit.
+ *
+ * @return  true if the dispatch queues could be changed.
+ */
+bool
+TomasuloSimulator::setDispatch(
+  const uint64_t capacity,
+  const uint64_t width
+)
+{
+  if (m_counter != 0) {
+    return false;
   }
+  m_dispatchQueueCapacity = capacity;
+  m_dispatchWidth = width;
+  for (std::vector<thread_context_t>::iterator t = m_threads.begin(); t != m_threads.end(); ++t) {
+    t->dispatch_queue = DispatchQueue(capacity);
+  }
+  return true;
+}
+
+/**
+ * @brief Function which writes the complete state of the simulator, along with
+ *        the statistics collected so far, to a checkpoint.
+ *
+ * @param f         Checkpoint file.
+ * @param p_stats   Pointer to the statistics structure.
+ *
+ * @return  true if the checkpoint was written.
+ */
+bool
+TomasuloSimulator::saveCheckpoint(
+  FILE* const f,
+  const proc_stats_t* const p_stats
+) const
+{
+  char magic[CHECKPOINT_MAGIC_SIZE];
+  memcpy(magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE);
+  uint32_t version = CHECKPOINT_VERSION;
+  uint32_t rsSize = sizeof(reservation_station_t);
+  uint64_t numResultBuses = m_resultBuses.size();
+  uint32_t numThreads = threads();
+  bool header = write_value(f, magic) && write_value(f, version) && write_value(f, rsSize) &&
+                write_value(f, numResultBuses) && write_value(f, m_numFUs) && write_value(f, m_fetchRate) &&
+                write_value(f, m_latency) && write_value(f, m_initiationInterval) &&
+                write_value(f, m_issuePolicy) && write_value(f, m_busPolicy) &&
+                write_value(f, numThreads) && write_value(f, m_fetchPolicy) &&
+                write_value(f, m_dispatchQueueCapacity) && write_value(f, m_dispatchWidth);
+  if (!header) {
+    return false;
+  }
+
+  // the dispatch queues are written along with the counters of their threads
+  bool threads = true;
+  for (std::vector<thread_context_t>::const_iterator t = m_threads.begin(); t != m_threads.end(); ++t) {
+    threads = threads && t->dispatch_queue.save(f) && write_value(f, t->done_fetching) &&
+              write_value(f, t->fetched) && write_value(f, t->retired) && write_value(f, t->retire_cycle) &&
+              write_value(f, t->icount);
+  }
+  if (!threads) {
+    return false;
+  }
+  std::array<std::vector<std::pair<unsigned long, uint32_t> >, NUM_FU_TYPES> executing;
+  for (uint64_t i = 0; i < NUM_FU_TYPES; ++i) {
+    executing[i].assign(m_executing[i].begin(), m_executing[i].end());
+  }
+
+  uint64_t numHistograms = m_histograms.size();
+  bool histograms = write_value(f, numHistograms);
+  for (std::vector<Histogram>::const_iterator h = m_histograms.begin(); h != m_histograms.end(); ++h) {
+    histograms = histograms && h->save(f);
+  }
+
+  return histograms &&
+         write_value(f, *p_stats) &&
+         m_schedulingQueue.save(f) &&
+         write_vector(f, m_instructionCycleLog) && write_value(f, m_loggedInstruction) && write_value(f, m_cycleLogMask) &&
+         write_vector(f, m_waitingInstructions) &&
+         write_vector(f, m_resultBuses) &&
+         write_value(f, m_scoreboard) &&
+         write_vector(f, executing[0]) && write_vector(f, executing[1]) && write_vector(f, executing[2]) &&
+         write_value(f, m_regFile) &&
+         write_value(f, m_fetchThread) && write_value(f, m_dispatchQueueCount) &&
+         write_value(f, m_reservedSlots) && write_value(f, m_dispatchWidthLimited) && write_value(f, m_broadcastBuses) && write_value(f, m_waitingToSchedule) &&
+         write_value(f, m_dispatchQueueSize) && write_value(f, m_firedInstruction) && write_value(f, m_retiredInstruction) &&
+         write_value(f, m_counter) && write_value(f, m_doneFetching) && write_value(f, m_randomState);
+}
+
+/**
+ * @brief Function which restores the state of the simulator, and the statistics,
+ *        from a checkpoint written with the same configuration. The trace or the
+ *        source has to be set again afterwards, fetch resumes from fetchedInstruction().
+ *
+ * @param f         Checkpoint file.
+ * @param p_stats   Pointer to the statistics structure.
+ *
+ * @return  true if the checkpoint was read and matches the configuration.
+ */
+bool
+TomasuloSimulator::loadCheckpoint(
+  FILE* const f,
+  proc_stats_t* const p_stats
+)
+{
+  char magic[CHECKPOINT_MAGIC_SIZE];
+  uint32_t version, rsSize;
+  uint64_t numResultBuses, fetchRate;
+  std::array<uint64_t, NUM_FU_TYPES> numFUs, latency, interval;
+  select_policy_t issuePolicy, busPolicy;
+  uint32_t numThreads;
+  fetch_policy_t fetchPolicy;
+  uint64_t dispatchQueueCapacity, dispatchWidth;
+  bool header = read_value(f, magic) && read_value(f, version) && read_value(f, rsSize) &&
+                read_value(f, numResultBuses) && read_value(f, numFUs) && read_value(f, fetchRate) &&
+                read_value(f, latency) && read_value(f, interval) &&
+                read_value(f, issuePolicy) && read_value(f, busPolicy) &&
+                read_value(f, numThreads) && read_value(f, fetchPolicy) &&
+                read_value(f, dispatchQueueCapacity) && read_value(f, dispatchWidth);
+  if (!header || (memcmp(magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE) != 0) ||
+      (version != CHECKPOINT_VERSION) || (rsSize != sizeof(reservation_station_t)) ||
+      (numResultBuses != m_resultBuses.size()) || (numFUs != m_numFUs) || (fetchRate != m_fetchRate) ||
+      (latency != m_latency) || (interval != m_initiationInterval) ||
+      (issuePolicy != m_issuePolicy) || (busPolicy != m_busPolicy) ||
+      (numThreads != threads()) || (fetchPolicy != m_fetchPolicy) ||
+      (dispatchQueueCapacity != m_dispatchQueueCapacity) || (dispatchWidth != m_dispatchWidth)) {
+    return false;
+  }
+
+  for (std::vector<thread_context_t>::iterator t = m_threads.begin(); t != m_threads.end(); ++t) {
+    if (!t->dispatch_queue.load(f) || !read_value(f, t->done_fetching) ||
+        !read_value(f, t->fetched) || !read_value(f, t->retired) || !read_value(f, t->retire_cycle) ||
+        !read_value(f, t->icount)) {
+      return false;
+    }
+    t->trace_cursor = NULL;
+    t->trace_end = NULL;
+    t->source = NULL;
+  }
+
+  // histograms have to be kept by both, or by neither
+  uint64_t numHistograms;
+  if (!read_value(f, numHistograms) || (numHistograms != m_histograms.size())) {
+    return false;
+  }
+  for (std::vector<Histogram>::iterator h = m_histograms.begin(); h != m_histograms.end(); ++h) {
+    if (!h->load(f)) {
+      return false;
+    }
+  }
+
+  std::array<std::vector<std::pair<unsigned long, uint32_t> >, NUM_FU_TYPES> executing;
+  bool state = read_value(f, *p_stats) &&
+               m_schedulingQueue.load(f) &&
+               read_vector(f, m_instructionCycleLog) && read_value(f, m_loggedInstruction) && read_value(f, m_cycleLogMask) &&
+               read_vector(f, m_waitingInstructions) &&
+               read_vector(f, m_resultBuses) &&
+               read_value(f, m_scoreboard) &&
+               read_vector(f, executing[0]) && read_vector(f, executing[1]) && read_vector(f, executing[2]) &&
+               read_value(f, m_regFile) &&
+               read_value(f, m_fetchThread) && read_value(f, m_dispatchQueueCount) &&
+               read_value(f, m_reservedSlots) && read_value(f, m_dispatchWidthLimited) && read_value(f, m_broadcastBuses) && read_value(f, m_waitingToSchedule) &&
+               read_value(f, m_dispatchQueueSize) && read_value(f, m_firedInstruction) && read_value(f, m_retiredInstruction) &&
+               read_value(f, m_counter) && read_value(f, m_doneFetching) && read_value(f, m_randomState);
+  if (!state || (m_instructionCycleLog.size() != (static_cast<uint64_t>(m_cycleLogMask) + 1))) {
+    return false;
+  }
+
+  for (uint64_t i = 0; i < NUM_FU_TYPES; ++i) {
+    m_executing[i].assign(executing[i].begin(), executing[i].end());
+  }
+  return true;
 }
 
 /**
@@ -116,39 +598,140 @@ TomasuloSimulator::fetch(
 )
 {
   if (!firstHalf) {
+    // a single thread fetches in each cycle
+    const uint32_t t = (m_threads.size() == 1) ? 0 : selectFetchThread();
+    thread_context_t& thread = m_threads[t];
+    m_fetchThread = t;
     for (uint64_t f = 0; f < m_fetchRate; ++f) {
+      if (thread.dispatch_queue.full() && !thread.done_fetching) {
+        // fetch waits for the dispatch queue to drain
+        ++p_stats->fetch_stall_cycles;
+        break;
+      }
       proc_inst_t p_inst;
-      if (read_instruction(&p_inst)) {
-        // create a new entry in the cycle log for the fetched instruction
-        m_instructionCycleLog.push_back(std::array<unsigned long, NUM_STAGES>());
-        // initialize logs with 0
-        (m_instructionCycleLog.rbegin())->fill(0);
+      bool fetched = false;
+      if (thread.trace_cursor != NULL) {
+        if (thread.trace_cursor != thread.trace_end) {
+          p_inst.instruction_address = thread.trace_cursor->instruction_address;
+          p_inst.op_code = thread.trace_cursor->op_code;
+          p_inst.src_reg[0] = thread.trace_cursor->src_reg[0];
+          p_inst.src_reg[1] = thread.trace_cursor->src_reg[1];
+          p_inst.dest_reg = thread.trace_cursor->dest_reg;
+          ++thread.trace_cursor;
+          fetched = true;
+        }
+      }
+      else if (thread.source != NULL) {
+        fetched = thread.source->next(&p_inst);
+      }
+      if (fetched) {
+        if ((m_counter - m_loggedInstruction) > m_cycleLogMask) {
+          // grow the cycle log if the ring is full of instructions in flight
+          allocateCycleLog();
+        }
+        if (t != 0) {
+          // the registers of a thread are renamed to its own slice of the register file
+          const int32_t base = static_cast<int32_t>(t * NUM_REGISTERS);
+          for (int32_t i = 0; i < 2; ++i) {
+            if (p_inst.src_reg[i] >= 0) {
+              p_inst.src_reg[i] += base;
+            }
+          }
+          if (p_inst.dest_reg >= 0) {
+            p_inst.dest_reg += base;
+          }
+        }
         // assign tag to be line number of the instruction
         p_inst.tag = m_counter++;
+        p_inst.thread = t;
+        ++thread.fetched;
+        ++thread.icount;
         // push the instruction to dispatch queue 
-        m_dispatchQueue.push(p_inst);
+        thread.dispatch_queue.push(p_inst);
+        ++m_dispatchQueueCount;
+        // initialize logs with 0
+        cycleLog(p_inst.tag).fill(0);
         // set instruction fetch cycle to current cycle 
-        m_instructionCycleLog[p_inst.tag][0] = p_stats->cycle_count;
+        cycleLog(p_inst.tag)[0] = p_stats->cycle_count;
         // set instruction dispatch cycle to next cycle 
-        m_instructionCycleLog[p_inst.tag][1] = (p_stats->cycle_count + 1);
+        cycleLog(p_inst.tag)[1] = (p_stats->cycle_count + 1);
 #if DEBUG_LOG
-        std::cerr << p_stats->cycle_count << "\tFETCHED\t" << (p_inst.tag + 1) << std::endl;
+        if (m_debugSink != NULL) {
+          m_debugSink->writeEvent(p_stats->cycle_count, "FETCHED", p_inst.tag + 1);
+        }
 #endif
       }
       else {
-        // no more instructions to fetch
+        // no more instructions to fetch for this thread
+        thread.done_fetching = true;
         m_doneFetching = true;
+        for (std::vector<thread_context_t>::const_iterator c = m_threads.begin(); c != m_threads.end(); ++c) {
+          m_doneFetching = m_doneFetching && c->done_fetching;
+        }
         break;
       }
     }
 
     // add to dispatch queue size for calculating average size later
-    m_dispatchQueueSize += m_dispatchQueue.size(); 
+    m_dispatchQueueSize += m_dispatchQueueCount; 
     // update maximum dispatch queue size
-    if (m_dispatchQueue.size() > p_stats->max_disp_size) {
-      p_stats->max_disp_size = static_cast<unsigned long>(m_dispatchQueue.size());
+    if (m_dispatchQueueCount > p_stats->max_disp_size) {
+      p_stats->max_disp_size = static_cast<unsigned long>(m_dispatchQueueCount);
+    }
+  }
+}
+
+/**
+ * @brief Function which picks the thread fetching in this cycle, among the
+ *        threads which still have instructions and room for them in their
+ *        dispatch queue. Round robin takes turns after
+ *        the thread which fetched last, ICOUNT picks the thread with the fewest
+ *        instructions waiting to be fired, with ties taking turns the same way.
+ */
+uint32_t
+TomasuloSimulator::selectFetchThread(
+) const
+{
+  const uint32_t numThreads = threads();
+  uint32_t selected = m_fetchThread;
+  bool found = false;
+  for (uint32_t i = 1; i <= numThreads; ++i) {
+    uint32_t t = (m_fetchThread + i) % numThreads;
+    if (m_threads[t].done_fetching || m_threads[t].dispatch_queue.full()) {
+      continue;
+    }
+    if (m_fetchPolicy == FETCH_ROUND_ROBIN) {
+      return t;
+    }
+    if (!found || (m_threads[t].icount < m_threads[selected].icount)) {
+      selected = t;
+      found = true;
     }
   }
+  return selected;
+}
+
+/**
+ * @brief Function which finds the thread whose dispatch queue holds the oldest
+ *        instruction, so that the instructions of all the threads reach the
+ *        scheduling queue in the order of their tags. At least one dispatch
+ *        queue has to hold an instruction.
+ */
+uint32_t
+TomasuloSimulator::oldestDispatchThread(
+) const
+{
+  uint32_t oldest = 0;
+  bool found = false;
+  for (uint32_t t = 0; t < threads(); ++t) {
+    const DispatchQueue& dispatchQueue = m_threads[t].dispatch_queue;
+    if (!dispatchQueue.empty() &&
+        (!found || (dispatchQueue.front().tag < m_threads[oldest].dispatch_queue.front().tag))) {
+      oldest = t;
+      found = true;
+    }
+  }
+  return oldest;
 }
 
 /**
@@ -165,17 +748,32 @@ TomasuloSimulator::dispatch(
 {
   if (firstHalf) {
     // reserve slots in the scheduling queue during first half cycle
-    m_reservedSlots = std::min(m_schedulingQueueCapacity - m_schedulingQueue.size(), m_dispatchQueue.size());
+    m_reservedSlots = std::min(m_schedulingQueueCapacity - m_schedulingQueue.size(), m_dispatchQueueCount);
+    // instructions left in the dispatch queue are held back by the full scheduling queue
+    p_stats->stall_sched_full += (m_dispatchQueueCount - m_reservedSlots);
+    m_dispatchWidthLimited = (m_dispatchWidth != 0) && (m_reservedSlots > m_dispatchWidth);
+    if (m_dispatchWidthLimited) {
+      // and the ones beyond the dispatch width wait for the next cycle
+      p_stats->stall_dispatch_width += (m_reservedSlots - m_dispatchWidth);
+      m_reservedSlots = m_dispatchWidth;
+    }
   }
   else {
     // push the instructions in scheduling queue in the second half cycle
-    while ((m_reservedSlots > 0) && (m_dispatchQueue.size() > 0)) { 
+    while ((m_reservedSlots > 0) && (m_dispatchQueueCount > 0)) { 
       reservation_station_t rs;
-      const proc_inst_t& p_inst = m_dispatchQueue.front();
+      DispatchQueue& dispatchQueue = m_threads[(m_threads.size() == 1) ? 0 : oldestDispatchThread()].dispatch_queue;
+      const proc_inst_t& p_inst = dispatchQueue.front();
 
       rs.op_code = p_inst.op_code;
+      rs.thread = p_inst.thread;
       rs.dest_reg = p_inst.dest_reg;
+      rs.dest_reg_tag = p_inst.tag;
+      rs.first_consumer = NO_CONSUMER;
+      rs.dependents = 0;
+      rs.height = 0;
       for (int32_t i = 0; i < 2; ++i) {
+        rs.next_consumer[i] = NO_CONSUMER;
         // check if the source register files are ready
         if ((p_inst.src_reg[i] < 0) || (m_regFile[p_inst.src_reg[i]].first)) {
           rs.src_reg_ready[i] = true;
@@ -184,25 +782,40 @@ TomasuloSimulator::dispatch(
           // store the tag of the file, if it is not ready
           rs.src_reg_tag[i] = m_regFile[p_inst.src_reg[i]].second;
           rs.src_reg_ready[i] = false;
+          // the producer has not broadcast its result yet, so it is in the scheduling queue
+          // add this operand to the list of its consumers, to be woken up by the broadcast
+          reservation_station_t& producer = m_schedulingQueue[rs.src_reg_tag[i]];
+          rs.next_consumer[i] = producer.first_consumer;
+          producer.first_consumer = (static_cast<uint64_t>(rs.dest_reg_tag) << 1) | i;
+          ++producer.dependents;
+          if ((m_issuePolicy == SELECT_LONGEST_CHAIN) || (m_busPolicy == SELECT_LONGEST_CHAIN)) {
+            raiseChainHeight(rs.src_reg_tag[i], 1);
+          }
         }
       }
       if (p_inst.dest_reg >= 0) {
         // mark register for destination register as not ready
         m_regFile[p_inst.dest_reg] = std::make_pair(false, p_inst.tag);
       }
-      rs.dest_reg_tag = p_inst.tag;
       rs.status = DISPATCHED;
       rs.clock_stamp = p_stats->cycle_count;
 
       // insert the instruction in scheduling queue
-      m_schedulingQueue.insert(std::make_pair(rs.dest_reg_tag, rs));
+      m_schedulingQueue.insert(rs);
+      ++m_waitingToSchedule;
+      if (rs.src_reg_ready[0] && rs.src_reg_ready[1]) {
+        m_schedulingQueue.setReady(rs.dest_reg_tag);
+      }
       // update the instruction cycle log for this instruction's schedule cycle
-      m_instructionCycleLog[p_inst.tag][2] = (p_stats->cycle_count + 1);
+      cycleLog(p_inst.tag)[2] = (p_stats->cycle_count + 1);
 #if DEBUG_LOG
-      std::cerr << p_stats->cycle_count << "\tDISPATCHED\t" << (p_inst.tag + 1) << std::endl;
+      if (m_debugSink != NULL) {
+        m_debugSink->writeEvent(p_stats->cycle_count, "DISPATCHED", p_inst.tag + 1);
+      }
 #endif
       // remove the scheduled instruction from dispatch queue
-      m_dispatchQueue.pop();
+      dispatchQueue.pop();
+      --m_dispatchQueueCount;
 
       --m_reservedSlots;
     }
@@ -221,50 +834,271 @@ TomasuloSimulator::schedule(
   const bool firstHalf
 )
 {
-  for (std::map<uint32_t, reservation_station_t>::iterator qe = m_schedulingQueue.begin(); qe != m_schedulingQueue.end(); ++qe) {
-    reservation_station_t& rs = qe->second;
-    // dispatched instructions may still be in the queue
-    // so can be the instructions which were added in this cycle
-    // need to ignore both of them
-    if ((rs.status != DISPATCHED) || (rs.clock_stamp == p_stats->cycle_count)) {
-      continue;
-    }
-    if (firstHalf) {
-      // if both the source registers are ready
-      if (rs.src_reg_ready[0] && rs.src_reg_ready[1]) {
-        // use functional unit 1 for instructions of type -1, as per instructions
-        int32_t op_code = (rs.op_code == -1) ? 1: rs.op_code;
-        // find a free slot in the functional unit
-        std::vector<int32_t>::iterator fu = std::find(m_scoreboard[op_code].begin(), m_scoreboard[op_code].end(), -1);
-        if (fu != m_scoreboard[op_code].end()) {
-          // schedule the instruction if a free functional unit is found
-          *fu = qe->first;
-          rs.status = SCHEDULED;
-          rs.clock_stamp = p_stats->cycle_count;
-          // update the instruction cycle log
-          m_instructionCycleLog[rs.dest_reg_tag][3] = (p_stats->cycle_count + 1);
-#if DEBUG_LOG
-          std::cerr << p_stats->cycle_count << "\tSCHEDULED\t" << (rs.dest_reg_tag + 1) << std::endl;
-#endif
-          m_firedInstruction += 1;
+  if (firstHalf) {
+    // reopen the units which can accept an instruction again in this cycle
+    for (uint32_t op_code = 0; op_code < NUM_FU_TYPES; ++op_code) {
+      scoreboard_t& sb = m_scoreboard[op_code];
+      uint64_t closed = sb.units & ~sb.free;
+      while (closed != 0) {
+        uint32_t fu = static_cast<uint32_t>(__builtin_ctzll(closed));
+        closed &= (closed - 1);
+        if ((sb.in_flight[fu] < m_unitCapacity[op_code]) && (sb.next_issue[fu] <= p_stats->cycle_count)) {
+          sb.free |= (static_cast<uint64_t>(1) << fu);
         }
       }
     }
+
+    uint64_t fired = 0;
+    // ready instructions which did not get a FU, because the FUs were busy executing
+    // or because they were held by results waiting for a result bus
+    uint64_t noFU = 0;
+    uint64_t resultBus = 0;
+    uint64_t waitingToSchedule = m_waitingToSchedule;
+    // only the dispatched instructions which have both the source registers ready
+    // are visited, in the order of their tags
+    if (m_issuePolicy == SELECT_OLDEST) {
+      uint32_t tag = m_schedulingQueue.beginReady();
+      while (tag != m_schedulingQueue.end()) {
+        uint32_t nextTag = m_schedulingQueue.nextReady(tag);
+        issue(p_stats, tag, fired, noFU, resultBus);
+        tag = nextTag;
+      }
+    }
     else {
-      // update source registers via broadcasted results on cdb
-      for (std::vector<result_bus_t>::const_iterator cdb = m_resultBuses.begin(); cdb != m_resultBuses.end(); ++cdb) {
-        if (cdb->busy) {
-          for (int32_t i = 0; i < 2; ++i) {
-            if (cdb->tag == rs.src_reg_tag[i]) {
-              rs.src_reg_ready[i] = true;
-            }
-          }
+      // the ready instructions are ordered by their priority first, then by their tags
+      m_candidates.clear();
+      for (uint32_t tag = m_schedulingQueue.beginReady(); tag != m_schedulingQueue.end(); tag = m_schedulingQueue.nextReady(tag)) {
+        m_candidates.push_back(std::make_pair(UINT64_MAX - selectKey(m_issuePolicy, tag), tag));
+      }
+      std::sort(m_candidates.begin(), m_candidates.end());
+      for (std::vector<std::pair<uint64_t, uint32_t> >::const_iterator c = m_candidates.begin(); c != m_candidates.end(); ++c) {
+        issue(p_stats, c->second, fired, noFU, resultBus);
+      }
+    }
+    // whatever is left in the queue is waiting for its operands
+    attributeIssueSlots(p_stats, fired, noFU, resultBus, waitingToSchedule - fired - noFU - resultBus);
+  }
+  else {
+    // update source registers of the consumers of the results broadcasted on cdb in this cycle
+    for (uint64_t b = 0; b < m_broadcastBuses; ++b) {
+      result_bus_t& cdb = m_resultBuses[b];
+      if (!cdb.busy) {
+        continue;
+      }
+      reservation_station_t& producer = m_schedulingQueue[cdb.tag];
+      uint64_t consumer = producer.first_consumer;
+      producer.first_consumer = NO_CONSUMER;
+      while (consumer != NO_CONSUMER) {
+        uint32_t tag = static_cast<uint32_t>(consumer >> 1);
+        int32_t i = static_cast<int32_t>(consumer & 1);
+        reservation_station_t& rs = m_schedulingQueue[tag];
+        rs.src_reg_ready[i] = true;
+        if (rs.src_reg_ready[0] && rs.src_reg_ready[1]) {
+          m_schedulingQueue.setReady(tag);
         }
+        consumer = rs.next_consumer[i];
       }
     }
   }
 }
 
+/**
+ * @brief Function which fires a ready instruction on the first free FU of its
+ *        type, or counts why it could not be fired.
+ *
+ * @param p_stats     Pointer to the statistics structure.
+ * @param tag         Tag of the instruction.
+ * @param fired       Number of instructions fired in this cycle.
+ * @param noFU        Ready instructions which found all FUs of their type executing.
+ * @param resultBus   Ready instructions which found FUs held by results waiting for a bus.
+ */
+inline
+void
+TomasuloSimulator::issue(
+  proc_stats_t* const p_stats,
+  const uint32_t tag,
+  uint64_t& fired,
+  uint64_t& noFU,
+  uint64_t& resultBus
+)
+{
+  reservation_station_t& rs = m_schedulingQueue[tag];
+  // use functional unit 1 for instructions of type -1, as per instructions
+  int32_t op_code = (rs.op_code == -1) ? 1: rs.op_code;
+  scoreboard_t& sb = m_scoreboard[op_code];
+  if (sb.free != 0) {
+    // schedule the instruction on the first free functional unit
+    uint32_t fu = static_cast<uint32_t>(__builtin_ctzll(sb.free));
+    sb.free &= ~(static_cast<uint64_t>(1) << fu);
+    ++sb.in_flight[fu];
+    sb.next_issue[fu] = p_stats->cycle_count + m_initiationInterval[op_code];
+    // execution starts in the next cycle, and the result is ready after the latency of the unit
+    m_executing[op_code].push_back(std::make_pair(p_stats->cycle_count + m_latency[op_code], tag));
+    rs.fu = fu;
+    rs.status = SCHEDULED;
+    rs.clock_stamp = p_stats->cycle_count;
+    m_schedulingQueue.clearReady(tag);
+    // update the instruction cycle log
+    cycleLog(rs.dest_reg_tag)[3] = (p_stats->cycle_count + 1);
+#if DEBUG_LOG
+    if (m_debugSink != NULL) {
+      m_debugSink->writeEvent(p_stats->cycle_count, "SCHEDULED", rs.dest_reg_tag + 1);
+    }
+#endif
+    m_firedInstruction += 1;
+    --m_threads[rs.thread].icount;
+    --m_waitingToSchedule;
+    ++fired;
+  }
+  else if (sb.waiting != 0) {
+    ++resultBus;
+  }
+  else {
+    ++noFU;
+  }
+}
+
+/**
+ * @brief Function which computes the priority of an instruction under a select
+ *        policy, higher priorities are picked first.
+ *
+ * @param policy  Select policy, other than oldest first.
+ * @param tag     Tag of the instruction.
+ */
+uint64_t
+TomasuloSimulator::selectKey(
+  const select_policy_t policy,
+  const uint32_t tag
+)
+{
+  switch (policy) {
+  case SELECT_LONGEST_CHAIN:
+    return m_schedulingQueue[tag].height;
+  case SELECT_MOST_DEPENDENTS:
+    return m_schedulingQueue[tag].dependents;
+  case SELECT_RANDOM:
+    // xorshift64*
+    m_randomState ^= m_randomState >> 12;
+    m_randomState ^= m_randomState << 25;
+    m_randomState ^= m_randomState >> 27;
+    return m_randomState * 0x2545f4914f6cdd1dULL;
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief Function which raises the chain heights of the producers of a newly
+ *        dispatched instruction, and of their own producers in turn, while the
+ *        new chain is longer than the ones they already head.
+ *
+ * @param tag     Tag of the producer.
+ * @param height  Length of the chain which now depends on the producer.
+ */
+void
+TomasuloSimulator::raiseChainHeight(
+  const uint32_t tag,
+  const uint32_t height
+)
+{
+  m_chainStack.clear();
+  m_chainStack.push_back(std::make_pair(tag, height));
+  while (!m_chainStack.empty()) {
+    std::pair<uint32_t, uint32_t> top = m_chainStack.back();
+    m_chainStack.pop_back();
+    reservation_station_t& rs = m_schedulingQueue[top.first];
+    if (rs.height >= top.second) {
+      continue;
+    }
+    rs.height = top.second;
+    for (int32_t i = 0; i < 2; ++i) {
+      if (!rs.src_reg_ready[i]) {
+        m_chainStack.push_back(std::make_pair(rs.src_reg_tag[i], top.second + 1));
+      }
+    }
+  }
+}
+
+/**
+ * @brief Function which moves the results to be broadcast in this cycle to the
+ *        front of the results waiting for a result bus, by their priority under
+ *        the bus policy. Results with the same priority keep their order.
+ *
+ * @param numResultBuses  Number of result buses.
+ */
+void
+TomasuloSimulator::orderWaitingInstructions(
+  const uint64_t numResultBuses
+)
+{
+  m_candidates.clear();
+  for (size_t w = 0; w < m_waitingInstructions.size(); ++w) {
+    m_candidates.push_back(std::make_pair(UINT64_MAX - selectKey(m_busPolicy, m_waitingInstructions[w].second), static_cast<uint32_t>(w)));
+  }
+  std::partial_sort(m_candidates.begin(), m_candidates.begin() + numResultBuses, m_candidates.end());
+  // the ones left behind keep their order, so they are granted oldest first once the policy ties
+  std::sort(m_candidates.begin() + numResultBuses, m_candidates.end(),
+            [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) { return a.second < b.second; });
+  m_reordered.clear();
+  for (std::vector<std::pair<uint64_t, uint32_t> >::const_iterator c = m_candidates.begin(); c != m_candidates.end(); ++c) {
+    m_reordered.push_back(m_waitingInstructions[c->second]);
+  }
+  m_waitingInstructions.swap(m_reordered);
+}
+
+/**
+ * @brief Function which attributes the issue slots of a cycle. Every slot which
+ *        was not used for firing an instruction is charged to one reason, in
+ *        the order of ready instructions without a FU, instructions waiting for
+ *        operands, then the instructions still in the dispatch queue, held back
+ *        by the scheduling queue or the dispatch width, and finally the front
+ *        end when the dispatch queue is empty.
+ *
+ * @param p_stats     Pointer to the statistics structure.
+ * @param fired       Number of instructions fired in this cycle.
+ * @param noFU        Ready instructions which found all FUs of their type executing.
+ * @param resultBus   Ready instructions which found FUs held by results waiting for a bus.
+ * @param operands    Instructions waiting for their operands.
+ */
+void
+TomasuloSimulator::attributeIssueSlots(
+  proc_stats_t* const p_stats,
+  const uint64_t fired,
+  const uint64_t noFU,
+  const uint64_t resultBus,
+  const uint64_t operands
+)
+{
+  p_stats->stall_no_fu += (noFU + resultBus);
+  p_stats->stall_operands += operands;
+
+  uint64_t lost = m_issueWidth - std::min(fired, m_issueWidth);
+  p_stats->slots_total += m_issueWidth;
+  p_stats->slots_fired += (m_issueWidth - lost);
+
+  uint64_t charged = std::min(lost, noFU);
+  p_stats->slots_no_fu += charged;
+  lost -= charged;
+  charged = std::min(lost, resultBus);
+  p_stats->slots_result_bus += charged;
+  lost -= charged;
+  charged = std::min(lost, operands);
+  p_stats->slots_operands += charged;
+  lost -= charged;
+  // slots left over with instructions waiting in the dispatch queue are lost to
+  // the back end: the slots freed by retirement are only refilled in the next
+  // cycle, unless the dispatch width held the instructions back
+  if (m_dispatchQueueCount == 0) {
+    p_stats->slots_frontend += lost;
+  }
+  else if (m_dispatchWidthLimited) {
+    p_stats->slots_dispatch_width += lost;
+  }
+  else {
+    p_stats->slots_sched_full += lost;
+  }
+}
+
 /**
  * @brief Function which executes instructions.
  *
@@ -278,55 +1112,70 @@ TomasuloSimulator::execute(
 )
 {
   if (firstHalf) {
-    std::map<uint32_t, std::pair<uint32_t, reservation_station_t*> > executedInstructions;
+    size_t executed = 0;
     for (uint32_t op_code = 0; op_code < NUM_FU_TYPES; ++op_code) {
-      for (std::vector<int32_t>::iterator i = m_scoreboard[op_code].begin(); i != m_scoreboard[op_code].end(); ++i) {
-        if (*i >= 0) {
-          uint32_t tag = static_cast<uint32_t>(*i);
-          reservation_station_t* rs = &m_schedulingQueue[tag];
-          if (rs->status == SCHEDULED) {
-            // mark scheduled instructions as executed and push them to executed instructions
-            rs->status = EXECUTED;
-            rs->clock_stamp = p_stats->cycle_count;
+      std::deque<std::pair<unsigned long, uint32_t> >& executing = m_executing[op_code];
+      // only visit the instructions which finish executing in this cycle
+      while (!executing.empty() && (executing.front().first <= p_stats->cycle_count)) {
+        uint32_t tag = executing.front().second;
+        executing.pop_front();
+        ++m_scoreboard[op_code].waiting;
+        reservation_station_t& rs = m_schedulingQueue[tag];
+        // mark scheduled instructions as executed and push them to executed instructions
+        rs.status = EXECUTED;
+        rs.clock_stamp = p_stats->cycle_count;
 #if DEBUG_LOG
-            std::cerr << p_stats->cycle_count << "\tEXECUTED\t" << (tag + 1) << std::endl;
-#endif
-            executedInstructions.insert(std::make_pair(tag, std::make_pair(op_code, rs)));
-          }
+        if (m_debugSink != NULL) {
+          m_debugSink->writeEvent(p_stats->cycle_count, "EXECUTED", tag + 1);
         }
+#endif
+        m_executedInstructions[executed++] = std::make_pair(tag, op_code);
       }
     }
-    // push all the instructions executed in this cycle to waiting instructions' queue
-    for (std::map<uint32_t, std::pair<uint32_t, reservation_station_t*> >::const_iterator ex = executedInstructions.begin(); ex != executedInstructions.end(); ++ex) {
-      m_waitingInstructions.push_back(ex->second);
+    // push all the instructions executed in this cycle to waiting instructions' queue, in the order of their tags
+    std::sort(m_executedInstructions.begin(), m_executedInstructions.begin() + executed);
+    for (size_t ex = 0; ex < executed; ++ex) {
+      m_waitingInstructions.push_back(std::make_pair(m_executedInstructions[ex].second, m_executedInstructions[ex].first));
     }
 
     // based on the availability of result buses, broadcast execution results and mark the instruction as complete
-    std::vector<std::pair<uint32_t, reservation_station_t*> >::iterator w = m_waitingInstructions.begin();
-    for (std::vector<result_bus_t>::iterator cdb = m_resultBuses.begin(); (cdb != m_resultBuses.end()) && (w != m_waitingInstructions.end()); ++cdb) {
+    if ((m_busPolicy != SELECT_OLDEST) && (m_waitingInstructions.size() > m_resultBuses.size())) {
+      orderWaitingInstructions(m_resultBuses.size());
+    }
+    std::vector<std::pair<uint32_t, uint32_t> >::iterator w = m_waitingInstructions.begin();
+    for (std::vector<result_bus_t>::iterator cdb = m_resultBuses.begin(); (cdb != m_resultBuses.end()) && (w != m_waitingInstructions.end()); ++cdb, ++w) {
       uint32_t op_code = w->first;
-      reservation_station_t* r = w->second;
+      reservation_station_t& r = m_schedulingQueue[w->second];
 
       cdb->busy = false;
-      if ((w->second)->dest_reg >= 0) {
+      if (r.dest_reg >= 0) {
         cdb->busy = true;
-        cdb->tag = r->dest_reg_tag;
-        cdb->reg = r->dest_reg;
+        cdb->tag = r.dest_reg_tag;
+        cdb->reg = r.dest_reg;
         // update the register file
         if (cdb->tag == m_regFile[cdb->reg].second) {
           m_regFile[cdb->reg].first = true;
         }
       }
 
-      // free the functional unit
-      std::vector<int32_t>::iterator fu = std::find(m_scoreboard[op_code].begin(), m_scoreboard[op_code].end(), static_cast<int32_t>(r->dest_reg_tag));
-      *fu = -1;
-
-      m_schedulingQueue[r->dest_reg_tag].status = COMPLETED;
-      m_schedulingQueue[r->dest_reg_tag].clock_stamp = p_stats->cycle_count;
+      // release the slot of the functional unit held by this instruction
+      scoreboard_t& sb = m_scoreboard[op_code];
+      --sb.in_flight[r.fu];
+      --sb.waiting;
+      // cycles from the start of execution to the broadcast of the result
+      unsigned long execCycles = p_stats->cycle_count - cycleLog(w->second)[3] + 1;
+      p_stats->exec_cycles += execCycles;
+      if (!m_histograms.empty()) {
+        m_histograms[HIST_RESULT_BUS_WAIT].record(execCycles - std::min(execCycles, static_cast<unsigned long>(m_latency[op_code])));
+      }
 
-      w = m_waitingInstructions.erase(w);
+      r.status = COMPLETED;
+      r.clock_stamp = p_stats->cycle_count;
     }
+    // remove the instructions which got a result bus
+    m_broadcastBuses = static_cast<uint64_t>(w - m_waitingInstructions.begin());
+    m_waitingInstructions.erase(m_waitingInstructions.begin(), w);
+    p_stats->stall_result_bus += m_waitingInstructions.size();
   }
 }
 
@@ -343,22 +1192,28 @@ TomasuloSimulator::stateUpdate(
 )
 {
   if (!firstHalf) {
-    std::map<uint32_t, reservation_station_t>::iterator qe = m_schedulingQueue.begin();
-    while (qe != m_schedulingQueue.end()) {
-      if (qe->second.clock_stamp < p_stats->cycle_count && qe->second.status == COMPLETED) {
+    for (uint32_t tag = m_schedulingQueue.begin(); tag != m_schedulingQueue.end(); tag = m_schedulingQueue.next(tag)) {
+      const reservation_station_t& rs = m_schedulingQueue[tag];
+      if (rs.clock_stamp < p_stats->cycle_count && rs.status == COMPLETED) {
         // update instruction cycle log
-        m_instructionCycleLog[qe->first][4] = p_stats->cycle_count;
+        cycleLog(tag)[4] = p_stats->cycle_count;
+        if (!m_histograms.empty()) {
+          recordRetiredLatencies(tag);
+        }
 #if DEBUG_LOG
-        std::cerr << p_stats->cycle_count << "\tSTATE UPDATE\t" << (qe->first + 1) << std::endl;
+        if (m_debugSink != NULL) {
+          m_debugSink->writeEvent(p_stats->cycle_count, "STATE UPDATE", tag + 1);
+        }
 #endif
+        ++m_threads[rs.thread].retired;
+        m_threads[rs.thread].retire_cycle = p_stats->cycle_count;
         // delete the instruction from scheduling queue
-        m_schedulingQueue.erase(qe++);
+        m_schedulingQueue.erase(tag);
         ++m_retiredInstruction;
       }
-      else {
-        ++qe;
-      }
     }
+    // write out the logs of the oldest instructions, if they have retired
+    writeRetiredCycles();
   }
 }
 
@@ -373,48 +1228,229 @@ TomasuloSimulator::simulateProcessor(
 )
 {
 #if DEBUG_LOG
-  std::cerr << "CYCLE\tOPERATION\tINSTRUCTION" << std::endl;
+  if (m_debugSink != NULL) {
+    m_debugSink->writeEventHeader();
+  }
 #endif
-
   while (!done()) {
+    cycle(p_stats);
+  }
+}
 
-    ++(p_stats->cycle_count);
+/**
+ * @brief Function which simulates the processor until its IPC has converged,
+ *        its budget of instructions is spent, or all the instructions have executed.
+ *
+ * @param p_stats   Pointer to the statistics structure.
+ * @param params    Window, tolerance and budget of the run.
+ * @param p_result  Pointer to the structure in which the estimate is returned.
+ *
+ * @return  true if the simulation stopped before all the instructions executed.
+ */
+bool
+TomasuloSimulator::simulateUntilConverged(
+  proc_stats_t* const p_stats,
+  const convergence_params_t& params,
+  convergence_t* const p_result
+)
+{
+#if DEBUG_LOG
+  if (m_debugSink != NULL) {
+    m_debugSink->writeEventHeader();
+  }
+#endif
+  ConvergenceMonitor monitor(params);
+  bool stopped = false;
+  while (!stopped && !done()) {
+    cycle(p_stats);
+    stopped = monitor.update(retiredInstruction(), p_stats->cycle_count);
+  }
+  if (!stopped) {
+    monitor.complete(retiredInstruction(), p_stats->cycle_count);
+  }
+  *p_result = monitor.result();
+  return stopped;
+}
+
+/**
+ * @brief Function which simulates one cycle of the processor.
+ *
+ * @param p_stats   Pointer to the statistics structure. 
+ */
+void
+TomasuloSimulator::cycle(
+  proc_stats_t* const p_stats
+)
+{
+  if (!m_cycleLogStarted) {
+    if (m_cycleLogSink != NULL) {
+      m_cycleLogSink->writeCycleHeader();
+    }
+    m_cycleLogStarted = true;
+  }
 
-    bool firstHalf = false;
+  ++(p_stats->cycle_count);
 
-    // Loop over all the stages twice for simulating
-    // each half cycle behavior.
-    do {
+  bool firstHalf = false;
 
-      firstHalf = !firstHalf;
+  // Loop over all the stages twice for simulating
+  // each half cycle behavior.
+  do {
 
-      stateUpdate(p_stats, firstHalf);
+    firstHalf = !firstHalf;
 
-      execute(p_stats, firstHalf);
+    stateUpdate(p_stats, firstHalf);
 
-      schedule(p_stats, firstHalf);
+    execute(p_stats, firstHalf);
 
-      dispatch(p_stats, firstHalf);
+    schedule(p_stats, firstHalf);
 
-      fetch(p_stats, firstHalf);
+    dispatch(p_stats, firstHalf);
 
-    } while (firstHalf);
+    fetch(p_stats, firstHalf);
 
+  } while (firstHalf);
+
+  if (!m_histograms.empty()) {
+    m_histograms[HIST_DISPATCH_QUEUE].record(m_dispatchQueueCount);
+    m_histograms[HIST_SCHEDULING_QUEUE].record(m_schedulingQueue.size());
+    m_histograms[HIST_RESULT_BUS_QUEUE].record(m_waitingInstructions.size());
   }
 }
 
 /**
- * @brief   Function which prints cycle by cycle output in the standard format.
+ * @brief   Function which finishes the cycle by cycle output in the standard format.
+ *          Rows are written as the instructions retire, so only the ones which are
+ *          still pending, if any, are written here.
  */
 void
 TomasuloSimulator::printInstructionCycles(
+)
+{
+  writeRetiredCycles();
+  if (m_cycleLogSink != NULL) {
+    m_cycleLogSink->writeEnd();
+  }
+}
+
+/**
+ * @brief Function which ends the cycle log: writes the rows of the retired
+ *        instructions which are still pending, closes the sink, which waits
+ *        until all its rows are in its file, and detaches it. No rows are
+ *        written afterwards, so the sink can be destroyed from then on.
+ */
+void
+TomasuloSimulator::finishCycleLog(
+)
+{
+  if (m_cycleLogSink == NULL) {
+    return;
+  }
+  printInstructionCycles();
+  m_cycleLogSink->close();
+  m_cycleLogSink = NULL;
+}
+
+/**
+ * @brief Function which records the stage to stage latencies of a retired instruction.
+ *
+ * @param tag   Tag of the instruction.
+ */
+void
+TomasuloSimulator::recordRetiredLatencies(
+  const uint32_t tag
+)
+{
+  const std::array<unsigned long, NUM_STAGES>& instCycle = cycleLog(tag);
+  m_histograms[HIST_FETCH_DISP].record(instCycle[1] - instCycle[0]);
+  m_histograms[HIST_DISP_SCHED].record(instCycle[2] - instCycle[1]);
+  m_histograms[HIST_SCHED_EXEC].record(instCycle[3] - instCycle[2]);
+  m_histograms[HIST_EXEC_STATE].record(instCycle[4] - instCycle[3]);
+  m_histograms[HIST_SCHED_STATE].record(instCycle[4] - instCycle[2]);
+  m_histograms[HIST_FETCH_STATE].record(instCycle[4] - instCycle[0]);
+}
+
+/**
+ * @brief Function which prints the percentiles of every histogram, if they are
+ *        being kept. Latencies are in cycles and occupancies in instructions.
+ *
+ * @param stream  Stream to print to.
+ */
+void
+TomasuloSimulator::printHistograms(
+  std::ostream& stream
+) const
+{
+  if (m_histograms.empty()) {
+    return;
+  }
+  static const char* names[NUM_HISTOGRAMS] = {
+    "FETCH->DISP",
+    "DISP->SCHED",
+    "SCHED->EXEC",
+    "EXEC->STATE",
+    "SCHED->STATE",
+    "FETCH->STATE",
+    "RESULT BUS WAIT",
+    "DISPATCH QUEUE",
+    "SCHEDULING QUEUE",
+    "RESULT BUS QUEUE"
+  };
+  stream << "HISTOGRAM\tCOUNT\tMEAN\tP50\tP90\tP99\tMAX" << '\n';
+  for (uint32_t h = 0; h < NUM_HISTOGRAMS; ++h) {
+    const Histogram& histogram = m_histograms[h];
+    stream << names[h] << '\t' << histogram.count() << '\t' << histogram.mean() << '\t' << histogram.percentile(50) << '\t'
+           << histogram.percentile(90) << '\t' << histogram.percentile(99) << '\t' << histogram.max() << '\n';
+  }
+  stream << std::endl;
+}
+
+/**
+ * @brief Function which adds up the memory held by the simulator itself: its
+ *        queues, rings, cycle logs and scratch space, but not the trace or the
+ *        instruction source. Vectors count their whole capacity, since they
+ *        keep it once grown. The deques of the instructions in the FUs, which
+ *        are empty once the trace has executed, are left out.
+ *
+ * @return  bytes held by the simulator.
+ */
+size_t
+TomasuloSimulator::allocatedBytes(
+) const
+{
+  size_t bytes = sizeof(TomasuloSimulator) + m_schedulingQueue.allocatedBytes();
+  for (std::vector<Histogram>::const_iterator h = m_histograms.begin(); h != m_histograms.end(); ++h) {
+    bytes += sizeof(Histogram) + h->allocatedBytes();
+  }
+  bytes += m_instructionCycleLog.capacity() * sizeof(std::array<unsigned long, NUM_STAGES>);
+  bytes += (m_waitingInstructions.capacity() + m_executedInstructions.capacity() + m_reordered.capacity() +
+            m_chainStack.capacity()) * sizeof(std::pair<uint32_t, uint32_t>);
+  bytes += m_candidates.capacity() * sizeof(std::pair<uint64_t, uint32_t>);
+  bytes += m_resultBuses.capacity() * sizeof(result_bus_t);
+  for (std::vector<thread_context_t>::const_iterator t = m_threads.begin(); t != m_threads.end(); ++t) {
+    bytes += sizeof(thread_context_t) + t->dispatch_queue.allocatedBytes();
+  }
+  return bytes;
+}
+
+/**
+ * @brief   Function which calculates the overall statistics of the simulation.
+ *
+ * @param p_stats   Pointer to the statistics structure, with the cycle count filled in.
+ */
+void
+TomasuloSimulator::computeStatistics(
+  proc_stats_t* const p_stats
 ) const
 {
-  std::cout << "INST\tFETCH\tDISP\tSCHED\tEXEC\tSTATE" << std::endl;
-  uint64_t instCount = 1;
-  for (std::vector<std::array<unsigned long, NUM_STAGES> >::const_iterator inst = m_instructionCycleLog.begin(); inst != m_instructionCycleLog.end(); ++inst, ++instCount) {
-    const std::array<unsigned long, NUM_STAGES>& instCycle = *inst;
-    std::cout << instCount << '\t' << instCycle[0] << '\t' << instCycle[1] << '\t' << instCycle[2] << '\t' << instCycle[3] << '\t' << instCycle[4] << std::endl;
+  double cycle_count_double = static_cast<double>(p_stats->cycle_count);
+  p_stats->retired_instruction = retiredInstruction();
+  p_stats->avg_inst_retired = retiredInstruction() / cycle_count_double; 
+  p_stats->avg_inst_fired = firedInstruction() / cycle_count_double; 
+  p_stats->avg_disp_size = dispatchQueueSize() / cycle_count_double;
+  p_stats->threads = threads();
+  for (uint32_t t = 0; t < MAX_SMT_THREADS; ++t) {
+    p_stats->thread_retired[t] = (t < threads()) ? threadRetired(t) : 0;
+    p_stats->thread_cycles[t] = (t < threads()) ? threadRetireCycle(t) : 0;
   }
-  std::cout << std::endl;
 }
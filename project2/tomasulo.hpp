@@ -1,24 +1,28 @@
+#ifndef TOMASULO_HPP
+#define TOMASULO_HPP
+
+#include "convergence.hpp"
+#include "dispatch_queue.hpp"
+#include "histogram.hpp"
+#include "output_sink.hpp"
 #include "procsim.hpp"
+#include "scheduling_queue.hpp"
 
 #include <array>
-#include <map>
-#include <queue>
+#include <deque>
+#include <iosfwd>
 #include <vector>
 
+// set this to 1 for writing out what happens in each cycle to the debug sink
+#define DEBUG_LOG 0
+
 #define NUM_REGISTERS 128
 #define NUM_STAGES 5
 #define NUM_FU_TYPES 3
+// the scoreboard keeps one bit per functional unit of a type in a 64 bit mask
+#define MAX_FUS_PER_TYPE 64
 
-
-/**
- * @brief enum for specifying state of an instruction in scheduling queue
- */
-enum schedule_status_t {
-  DISPATCHED,
-  SCHEDULED,
-  EXECUTED,
-  COMPLETED
-};
+class InstructionSource;
 
 /**
  * @brief Struct for storing result bus data
@@ -30,24 +34,93 @@ typedef struct _result_bus_t {
 } result_bus_t;
 
 /**
- * @brief struct for storing each scheduling queue entry
+ * @brief enum for the histograms which can be kept during simulation, the
+ *        stage to stage latencies of every instruction and the occupancies
+ *        of the queues in every cycle
  */
-typedef struct _reservation_station_t {
-  int32_t op_code;
-  bool src_reg_ready[2];
-  uint32_t src_reg_tag[2];
-  int32_t dest_reg;
-  uint32_t dest_reg_tag;
+enum histogram_id_t {
+  HIST_FETCH_DISP,
+  HIST_DISP_SCHED,
+  HIST_SCHED_EXEC,
+  HIST_EXEC_STATE,
+  HIST_SCHED_STATE,
+  HIST_FETCH_STATE,
+  HIST_RESULT_BUS_WAIT,
+  HIST_DISPATCH_QUEUE,
+  HIST_SCHEDULING_QUEUE,
+  HIST_RESULT_BUS_QUEUE,
+  NUM_HISTOGRAMS
+};
 
-  unsigned long clock_stamp;
-  schedule_status_t status;
+/**
+ * @brief enum for the policies which pick the ready instructions fired on the
+ *        free FUs, and the results broadcast on the result buses. Ties are
+ *        broken in favour of the oldest instruction.
+ */
+enum select_policy_t {
+  SELECT_OLDEST,
+  SELECT_LONGEST_CHAIN,
+  SELECT_MOST_DEPENDENTS,
+  SELECT_RANDOM,
+  NUM_SELECT_POLICIES
+};
 
-  bool operator==(const _reservation_station_t& rs) const
-  {
-    return (dest_reg_tag == rs.dest_reg_tag);
-  }
+bool parse_select_policy(const char* const, select_policy_t* const);
+
+/**
+ * @brief enum for the policies which pick the thread fetching in a cycle when
+ *        several threads share the core.
+ */
+enum fetch_policy_t {
+  FETCH_ROUND_ROBIN,
+  FETCH_ICOUNT,
+  NUM_FETCH_POLICIES
+};
+
+bool parse_fetch_policy(const char* const, fetch_policy_t* const);
+
+/**
+ * @brief Struct for storing the front end of one hardware thread. Threads have
+ *        their own instructions and dispatch queue, and share everything from
+ *        the scheduling queue on. The architectural registers of a thread are
+ *        its own slice of the register file.
+ */
+typedef struct _thread_context_t {
+  // dispatch queue
+  DispatchQueue dispatch_queue;
 
-} reservation_station_t;
+  // cursor in the memory mapped trace, if one is being used
+  const trace_record_t* trace_cursor;
+  const trace_record_t* trace_end;
+
+  // source of the instructions if no memory mapped trace is being used, not owned
+  InstructionSource* source;
+
+  bool done_fetching;
+
+  unsigned long fetched;
+  unsigned long retired;
+  // cycle in which the last instruction of the thread retired
+  unsigned long retire_cycle;
+  // instructions fetched and not fired yet, which the ICOUNT policy keeps balanced
+  unsigned long icount;
+} thread_context_t;
+
+/**
+ * @brief Struct for storing the scoreboard of one type of functional units
+ */
+typedef struct _scoreboard_t {
+  // one bit per unit of this type
+  uint64_t units;
+  // one bit per unit, set if the unit can accept an instruction
+  uint64_t free;
+  // number of results of this type which are waiting for a result bus
+  uint64_t waiting;
+  // number of instructions held by each unit, either executing or waiting for a result bus
+  std::array<uint32_t, MAX_FUS_PER_TYPE> in_flight;
+  // cycle from which each unit can accept its next instruction
+  std::array<unsigned long, MAX_FUS_PER_TYPE> next_issue;
+} scoreboard_t;
 
 class TomasuloSimulator {
 public:
@@ -55,17 +128,63 @@ public:
 
   TomasuloSimulator(const uint64_t, const uint64_t[NUM_FU_TYPES], const uint64_t);
 
-  TomasuloSimulator(const TomasuloSimulator& ts);
-
   void simulateProcessor(proc_stats_t* const);
 
-  void printInstructionCycles() const;
+  bool simulateUntilConverged(proc_stats_t* const, const convergence_params_t&, convergence_t* const);
+
+  void cycle(proc_stats_t* const);
+
+  bool done() const { return m_doneFetching && (m_schedulingQueue.size() == 0); }
+
+  void printInstructionCycles();
+
+  void enableHistograms() { m_histograms.resize(NUM_HISTOGRAMS); }
+
+  void printHistograms(std::ostream&) const;
+
+  void computeStatistics(proc_stats_t* const) const;
+
+  size_t allocatedBytes() const;
+
+  void setCycleLogSink(OutputSink* const sink) { m_cycleLogSink = sink; }
+
+  void finishCycleLog();
+
+  void setDebugSink(OutputSink* const sink) { m_debugSink = sink; }
+
+  void setTrace(const trace_record_t* const, const trace_record_t* const);
+
+  void setSource(InstructionSource* const);
+
+  bool setThreads(const uint32_t, const fetch_policy_t);
+
+  void setThreadTrace(const uint32_t, const trace_record_t* const, const trace_record_t* const);
+
+  void setThreadSource(const uint32_t, InstructionSource* const);
+
+  void setFUTiming(const uint64_t[NUM_FU_TYPES], const uint64_t[NUM_FU_TYPES]);
+
+  void setSelectPolicy(const select_policy_t, const select_policy_t);
+
+  bool setDispatch(const uint64_t, const uint64_t);
+
+  bool saveCheckpoint(FILE* const, const proc_stats_t* const) const;
+
+  bool loadCheckpoint(FILE* const, proc_stats_t* const);
 
   unsigned long dispatchQueueSize() const { return m_dispatchQueueSize; }
 
   unsigned long firedInstruction() const { return m_firedInstruction; }
 
-  unsigned long retiredInstruction() const { return m_firedInstruction; }
+  unsigned long retiredInstruction() const { return m_retiredInstruction; }
+
+  unsigned long fetchedInstruction() const { return m_counter; }
+
+  uint32_t threads() const { return static_cast<uint32_t>(m_threads.size()); }
+
+  unsigned long threadRetired(const uint32_t thread) const { return m_threads[thread].retired; }
+
+  unsigned long threadRetireCycle(const uint32_t thread) const { return m_threads[thread].retire_cycle; }
 
 private:
   void fetch(proc_stats_t* const, const bool);
@@ -77,34 +196,102 @@ private:
   void execute(proc_stats_t* const, const bool);
 
   void stateUpdate(proc_stats_t* const, const bool);
-  
-  bool done() const { return m_doneFetching && (m_schedulingQueue.size() == 0); }
+
+  uint32_t selectFetchThread() const;
+
+  uint32_t oldestDispatchThread() const;
+
+  std::array<unsigned long, NUM_STAGES>& cycleLog(const uint32_t tag) { return m_instructionCycleLog[tag & m_cycleLogMask]; }
+
+  void allocateCycleLog();
+
+  void writeRetiredCycles();
+
+  void recordRetiredLatencies(const uint32_t);
+
+  void attributeIssueSlots(proc_stats_t* const, const uint64_t, const uint64_t, const uint64_t, const uint64_t);
+
+  void issue(proc_stats_t* const, const uint32_t, uint64_t&, uint64_t&, uint64_t&);
+
+  uint64_t selectKey(const select_policy_t, const uint32_t);
+
+  void raiseChainHeight(const uint32_t, const uint32_t);
+
+  void orderWaitingInstructions(const uint64_t);
 
 private:
-  // data structure for scheduling queue, std::map stores instructions sorted by tags
-  std::map<uint32_t, reservation_station_t> m_schedulingQueue;
+  // data structure for scheduling queue, iterated in the order of tags
+  SchedulingQueue m_schedulingQueue;
+
+  // histograms indexed by histogram_id_t, empty if they are not being kept
+  std::vector<Histogram> m_histograms;
 
-  // data structure for storing instruction cycle logs
+  // ring of instruction cycle logs, indexed by tag, for the instructions in flight
   std::vector<std::array<unsigned long, NUM_STAGES> > m_instructionCycleLog;
 
-  // data structure for storing instructions waiting for result buses
-  std::vector<std::pair<uint32_t, reservation_station_t*> > m_waitingInstructions;
+  // data structure for storing FU type and tag of instructions waiting for result buses
+  std::vector<std::pair<uint32_t, uint32_t> > m_waitingInstructions;
+
+  // scratch space for tag and FU type of the instructions executed in a cycle
+  std::vector<std::pair<uint32_t, uint32_t> > m_executedInstructions;
+
+  // policies picking the instructions to fire and the results to broadcast
+  select_policy_t m_issuePolicy;
+  select_policy_t m_busPolicy;
+  // state of the generator used by the random policy
+  uint64_t m_randomState;
+  // scratch space for ordering the candidates of a policy by (inverted priority, tag or position)
+  std::vector<std::pair<uint64_t, uint32_t> > m_candidates;
+  std::vector<std::pair<uint32_t, uint32_t> > m_reordered;
+  // scratch space for raising the chain heights of the producers of an instruction
+  std::vector<std::pair<uint32_t, uint32_t> > m_chainStack;
 
   // data structure for result buses
   std::vector<result_bus_t> m_resultBuses;
 
   // scoreboard for keeping track of availability of FUs
-  std::array<std::vector<int32_t>, NUM_FU_TYPES> m_scoreboard;
-
-  // register file
-  std::array<std::pair<bool, uint32_t>, NUM_REGISTERS> m_regFile;
-
-  // dispatch queue
-  std::queue<proc_inst_t> m_dispatchQueue;
+  std::array<scoreboard_t, NUM_FU_TYPES> m_scoreboard;
+
+  // cycle at which execution finishes and tag of the instructions executing on
+  // each type of FUs, in the order of completion
+  std::array<std::deque<std::pair<unsigned long, uint32_t> >, NUM_FU_TYPES> m_executing;
+
+  // register file, with a slice of NUM_REGISTERS registers for every thread
+  std::array<std::pair<bool, uint32_t>, NUM_REGISTERS * MAX_SMT_THREADS> m_regFile;
+
+  // front end of every hardware thread
+  std::vector<thread_context_t> m_threads;
+  fetch_policy_t m_fetchPolicy;
+  // thread which fetched last, where the round robin policy starts looking
+  uint32_t m_fetchThread;
+  // number of instructions in the dispatch queues of all the threads
+  size_t m_dispatchQueueCount;
+  // capacity of the dispatch queue of every thread, and the number of
+  // instructions dispatched in a cycle, or 0 if they are not limited
+  uint64_t m_dispatchQueueCapacity;
+  uint64_t m_dispatchWidth;
+  // set if the dispatch width held back instructions in the last dispatch
+  bool m_dispatchWidthLimited;
+
+  // number of functional units of each type
+  std::array<uint64_t, NUM_FU_TYPES> m_numFUs;
+
+  // latency and initiation interval of each type of functional units, and the
+  // number of instructions every unit of the type can hold at once
+  std::array<uint64_t, NUM_FU_TYPES> m_latency;
+  std::array<uint64_t, NUM_FU_TYPES> m_initiationInterval;
+  std::array<uint64_t, NUM_FU_TYPES> m_unitCapacity;
 
   uint64_t m_schedulingQueueCapacity;
   uint64_t m_fetchRate;
+  // number of instructions which can be fired in a cycle
+  uint64_t m_issueWidth;
   uint64_t m_reservedSlots;
+  // number of result buses which were given to instructions in this cycle
+  uint64_t m_broadcastBuses;
+
+  // number of instructions in the scheduling queue which are yet to be scheduled
+  unsigned long m_waitingToSchedule;
 
   unsigned long m_dispatchQueueSize;
   unsigned long m_firedInstruction;
@@ -112,5 +299,18 @@ private:
 
   uint32_t m_counter;
 
+  // tag of the oldest instruction whose cycle log has not been written yet
+  uint32_t m_loggedInstruction;
+  uint32_t m_cycleLogMask;
+
+  // sink to which the cycle log is written as instructions retire, NULL if disabled
+  OutputSink* m_cycleLogSink;
+  // sink to which every event is written when DEBUG_LOG is set, NULL if disabled
+  OutputSink* m_debugSink;
+  bool m_cycleLogStarted;
+
+  // set once every thread is done fetching
   bool m_doneFetching;
 };
+
+#endif /* TOMASULO_HPP */
@@ -0,0 +1,214 @@
+#include "trace.hpp"
+
+#include "block_trace.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * @brief Default constructor, creates an empty trace.
+ */
+BinaryTrace::BinaryTrace(
+) : m_mapping(NULL),
+  m_mappingSize(0),
+  m_records(NULL),
+  m_instructionCount(0)
+{
+}
+
+/**
+ * @brief Destructor, unmaps the trace file if one is mapped.
+ */
+BinaryTrace::~BinaryTrace(
+)
+{
+  close();
+}
+
+/**
+ * @brief Function which maps a binary trace file in memory.
+ *
+ * @param fileName  Name of the binary trace file.
+ *
+ * @return  true if the file was mapped and has a valid header.
+ */
+bool
+BinaryTrace::open(
+  const char* const fileName
+)
+{
+  close();
+
+  int fd = ::open(fileName, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if ((fstat(fd, &st) != 0) || (static_cast<size_t>(st.st_size) < sizeof(trace_header_t))) {
+    ::close(fd);
+    return false;
+  }
+  void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  m_mapping = mapping;
+  m_mappingSize = st.st_size;
+
+  const trace_header_t* header = static_cast<const trace_header_t*>(m_mapping);
+  uint64_t available = (m_mappingSize - sizeof(trace_header_t)) / sizeof(trace_record_t);
+  if ((memcmp(header->magic, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0) ||
+      (header->version != TRACE_VERSION) ||
+      (header->record_size != sizeof(trace_record_t)) ||
+      (header->instruction_count > available)) {
+    close();
+    return false;
+  }
+  // the trace is always read front to back
+  madvise(m_mapping, m_mappingSize, MADV_SEQUENTIAL);
+
+  m_records = reinterpret_cast<const trace_record_t*>(header + 1);
+  m_instructionCount = header->instruction_count;
+  return true;
+}
+
+/**
+ * @brief Function which unmaps the trace file.
+ */
+void
+BinaryTrace::close(
+)
+{
+  if (m_mapping != NULL) {
+    munmap(m_mapping, m_mappingSize);
+  }
+  m_mapping = NULL;
+  m_mappingSize = 0;
+  m_records = NULL;
+  m_instructionCount = 0;
+}
+
+/**
+ * @brief Function which checks if a file starts with the binary trace magic.
+ *
+ * @param fileName  Name of the file to be checked.
+ */
+bool
+BinaryTrace::isBinaryTrace(
+  const char* const fileName
+)
+{
+  char magic[TRACE_MAGIC_SIZE];
+  FILE* f = fopen(fileName, "rb");
+  if (f == NULL) {
+    return false;
+  }
+  bool isBinary = (fread(magic, 1, TRACE_MAGIC_SIZE, f) == TRACE_MAGIC_SIZE) &&
+                  (memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_SIZE) == 0);
+  fclose(f);
+  return isBinary;
+}
+
+/**
+ * @brief Default constructor, creates an empty trace.
+ */
+TraceBuffer::TraceBuffer(
+) : m_binaryTrace(),
+  m_records(),
+  m_begin(NULL),
+  m_end(NULL)
+{
+}
+
+/**
+ * @brief Function which loads a binary, a block compressed or a text trace.
+ *        Block compressed traces are decompressed on all the cores.
+ *
+ * @param fileName  Name of the trace file.
+ *
+ * @return  true if the trace was loaded.
+ */
+bool
+TraceBuffer::load(
+  const char* const fileName
+)
+{
+  if (BinaryTrace::isBinaryTrace(fileName)) {
+    if (!m_binaryTrace.open(fileName)) {
+      return false;
+    }
+    m_begin = m_binaryTrace.begin();
+    m_end = m_binaryTrace.end();
+    return true;
+  }
+
+  if (BlockTrace::isBlockTrace(fileName)) {
+    BlockTrace blockTrace;
+    if (!blockTrace.open(fileName) ||
+        !blockTrace.decode(0, blockTrace.blockCount(), m_records, std::thread::hardware_concurrency())) {
+      return false;
+    }
+    m_begin = m_records.data();
+    m_end = m_begin + m_records.size();
+    return true;
+  }
+
+  FILE* f = fopen(fileName, "r");
+  if (f == NULL) {
+    return false;
+  }
+  trace_record_t record;
+  while (read_text_record(f, &record)) {
+    m_records.push_back(record);
+  }
+  fclose(f);
+  m_begin = m_records.data();
+  m_end = m_begin + m_records.size();
+  return true;
+}
+
+/**
+ * @brief Function which reads one instruction from a text trace.
+ *
+ * @param f       Text trace to read from.
+ * @param record  Record to populate.
+ *
+ * @return  true if an instruction was read successfully.
+ */
+bool
+read_text_record(
+  FILE* const f,
+  trace_record_t* const record
+)
+{
+  int ret = fscanf(f, "%x %d %d %d %d\n", &record->instruction_address,
+                   &record->op_code, &record->dest_reg, &record->src_reg[0], &record->src_reg[1]);
+  return (ret == 5);
+}
+
+/**
+ * @brief Function which writes the binary trace header.
+ *
+ * @param f       Binary trace to write to.
+ * @param count   Number of instructions in the trace.
+ */
+bool
+write_trace_header(
+  FILE* const f,
+  const uint64_t count
+)
+{
+  trace_header_t header;
+  memset(&header, 0, sizeof(trace_header_t));
+  memcpy(header.magic, TRACE_MAGIC, TRACE_MAGIC_SIZE);
+  header.version = TRACE_VERSION;
+  header.record_size = sizeof(trace_record_t);
+  header.instruction_count = count;
+  return (fwrite(&header, sizeof(trace_header_t), 1, f) == 1);
+}
@@ -0,0 +1,97 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#define TRACE_MAGIC "PSIMTRC"
+#define TRACE_MAGIC_SIZE 8
+#define TRACE_VERSION 1
+
+/**
+ * @brief Header at the start of every binary trace file.
+ */
+typedef struct _trace_header_t {
+  char magic[TRACE_MAGIC_SIZE];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t instruction_count;
+} trace_header_t;
+
+/**
+ * @brief Fixed size record for one instruction in a binary trace,
+ *        laid out in the same order as the fields of proc_inst_t.
+ */
+typedef struct _trace_record_t {
+  uint32_t instruction_address;
+  int32_t op_code;
+  int32_t src_reg[2];
+  int32_t dest_reg;
+} trace_record_t;
+
+/**
+ * @brief Read-only, memory mapped view of a binary trace file.
+ */
+class BinaryTrace {
+public:
+  BinaryTrace();
+
+  ~BinaryTrace();
+
+  bool open(const char* const);
+
+  void close();
+
+  const trace_record_t* begin() const { return m_records; }
+
+  const trace_record_t* end() const { return m_records + m_instructionCount; }
+
+  uint64_t size() const { return m_instructionCount; }
+
+  static bool isBinaryTrace(const char* const);
+
+private:
+  // mapping is owned by the instance, so it can not be copied
+  BinaryTrace(const BinaryTrace&);
+
+  BinaryTrace& operator=(const BinaryTrace&);
+
+private:
+  void* m_mapping;
+  size_t m_mappingSize;
+
+  const trace_record_t* m_records;
+  uint64_t m_instructionCount;
+};
+
+/**
+ * @brief Immutable, fully decoded trace which can be shared by several simulators.
+ *        Binary traces are mapped in place, text traces are parsed once in memory.
+ */
+class TraceBuffer {
+public:
+  TraceBuffer();
+
+  bool load(const char* const);
+
+  const trace_record_t* begin() const { return m_begin; }
+
+  const trace_record_t* end() const { return m_end; }
+
+  uint64_t size() const { return static_cast<uint64_t>(m_end - m_begin); }
+
+private:
+  BinaryTrace m_binaryTrace;
+  std::vector<trace_record_t> m_records;
+
+  const trace_record_t* m_begin;
+  const trace_record_t* m_end;
+};
+
+bool read_text_record(FILE* const, trace_record_t* const);
+
+bool write_trace_header(FILE* const, const uint64_t);
+
+#endif /* TRACE_HPP */
@@ -0,0 +1,125 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "block_trace.hpp"
+#include "trace.hpp"
+
+void print_help_and_exit(void) {
+    printf("trace_convert [OPTIONS]\n");
+    printf("  -i traces/file.trace\tText, binary or block compressed trace to convert (default: text on stdin)\n");
+    printf("  -o traces/file.bin\tBinary trace to write\n");
+    printf("  -z\t\t\tWrite a block compressed trace instead\n");
+    printf("  -B N\t\t\tNumber of instructions in a compressed block (default: %d)\n", DEFAULT_BLOCK_RECORDS);
+    printf("  -h\t\t\tThis helpful output\n");
+    exit(0);
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    FILE* inFile = stdin;
+    const char* outName = NULL;
+    TraceBuffer inTrace;
+    bool compress = false;
+    uint32_t blockRecords = DEFAULT_BLOCK_RECORDS;
+
+    while(-1 != (opt = getopt(argc, argv, "i:o:zB:h"))) {
+        switch(opt) {
+        case 'i':
+            if (BinaryTrace::isBinaryTrace(optarg) || BlockTrace::isBlockTrace(optarg))
+            {
+                if (!inTrace.load(optarg))
+                {
+                    fprintf(stderr, "Failed to load trace %s\n", optarg);
+                    print_help_and_exit();
+                }
+                inFile = NULL;
+                break;
+            }
+            inFile = fopen(optarg, "r");
+            if (inFile == NULL)
+            {
+                fprintf(stderr, "Failed to open %s for reading\n", optarg);
+                print_help_and_exit();
+            }
+            break;
+        case 'o':
+            outName = optarg;
+            break;
+        case 'z':
+            compress = true;
+            break;
+        case 'B':
+            blockRecords = strtoul(optarg, NULL, 10);
+            break;
+        case 'h':
+            /* Fall through */
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+
+    if ((outName == NULL) || (blockRecords == 0)) {
+        print_help_and_exit();
+    }
+
+    if (compress) {
+        BlockTraceWriter writer;
+        if (!writer.open(outName, blockRecords)) {
+            fprintf(stderr, "Failed to open %s for writing\n", outName);
+            return 1;
+        }
+        bool written = true;
+        trace_record_t record;
+        if (inFile == NULL) {
+            for (const trace_record_t* r = inTrace.begin(); written && (r != inTrace.end()); ++r) {
+                written = writer.append(*r);
+            }
+        }
+        else {
+            while (written && read_text_record(inFile, &record)) {
+                written = writer.append(record);
+            }
+        }
+        if (!writer.close() || !written) {
+            fprintf(stderr, "Failed to write %s\n", outName);
+            return 1;
+        }
+        printf("Compressed %" PRIu64 " instructions to %" PRIu64 " bytes\n", writer.size(), writer.compressedSize());
+        return 0;
+    }
+
+    FILE* outFile = fopen(outName, "wb");
+    if (outFile == NULL)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", outName);
+        return 1;
+    }
+
+    /* Write a placeholder header, the count is known only at the end */
+    uint64_t count = 0;
+    write_trace_header(outFile, count);
+
+    trace_record_t record;
+    const trace_record_t* next = inTrace.begin();
+    while ((inFile != NULL) ? read_text_record(inFile, &record) : (next != inTrace.end())) {
+        if (inFile == NULL) {
+            record = *next++;
+        }
+        if (fwrite(&record, sizeof(trace_record_t), 1, outFile) != 1) {
+            fprintf(stderr, "Failed to write %s\n", outName);
+            return 1;
+        }
+        ++count;
+    }
+
+    rewind(outFile);
+    if (!write_trace_header(outFile, count) || (fclose(outFile) != 0)) {
+        fprintf(stderr, "Failed to write %s\n", outName);
+        return 1;
+    }
+
+    printf("Converted %" PRIu64 " instructions\n", count);
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "trace_gen.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Function which returns the default parameters, a mix of all the op
+ *        codes with short dependencies over all the registers.
+ */
+trace_gen_params_t
+TraceGenerator::defaultParams(
+)
+{
+  trace_gen_params_t params;
+  params.seed = 1;
+  params.op_mix[0] = 1.0;
+  params.op_mix[1] = 1.0;
+  params.op_mix[2] = 1.0;
+  params.op_mix[3] = 1.0;
+  params.mean_distance = 4.0;
+  params.max_distance = 64;
+  params.registers = 128;
+  params.no_dest = 0.125;
+  params.no_src = 0.0;
+  params.phase_length = 0;
+  params.phase_distance_scale = 4.0;
+  return params;
+}
+
+/**
+ * @brief Constructor for a generator, which always generates the same trace
+ *        for the same parameters.
+ *
+ * @param params  Parameters of the trace.
+ */
+TraceGenerator::TraceGenerator(
+  const trace_gen_params_t& params
+) : m_params(params),
+  m_meanDistance(params.mean_distance),
+  m_recentDest(std::max(params.max_distance, static_cast<uint32_t>(1)), -1),
+  m_state(params.seed * 0x9E3779B97F4A7C15ULL + 1),
+  m_count(0)
+{
+  m_params.max_distance = static_cast<uint32_t>(m_recentDest.size());
+  m_params.registers = std::min(std::max(m_params.registers, static_cast<uint32_t>(1)), static_cast<uint32_t>(128));
+  startPhase();
+}
+
+/**
+ * @brief Function which returns the next number of the xorshift64* generator.
+ */
+uint64_t
+TraceGenerator::random(
+)
+{
+  m_state ^= m_state >> 12;
+  m_state ^= m_state << 25;
+  m_state ^= m_state >> 27;
+  return m_state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Function which sets up the op mix and the mean distance of the phase
+ *        of the next instruction.
+ */
+void
+TraceGenerator::startPhase(
+)
+{
+  uint64_t phase = (m_params.phase_length > 0) ? (m_count / m_params.phase_length) : 0;
+  // op code -1 keeps its weight, the weights of the FU types rotate
+  double weights[TRACE_GEN_OP_CODES];
+  weights[0] = m_params.op_mix[0];
+  for (uint32_t op = 0; op < (TRACE_GEN_OP_CODES - 1); ++op) {
+    weights[1 + ((op + phase) % (TRACE_GEN_OP_CODES - 1))] = m_params.op_mix[1 + op];
+  }
+  double total = 0.0;
+  for (uint32_t op = 0; op < TRACE_GEN_OP_CODES; ++op) {
+    total += std::max(weights[op], 0.0);
+  }
+  double cumulative = 0.0;
+  for (uint32_t op = 0; op < TRACE_GEN_OP_CODES; ++op) {
+    cumulative += (total > 0.0) ? (std::max(weights[op], 0.0) / total) : (1.0 / TRACE_GEN_OP_CODES);
+    m_opThreshold[op] = cumulative;
+  }
+  m_meanDistance = m_params.mean_distance * (((phase % 2) == 1) ? m_params.phase_distance_scale : 1.0);
+}
+
+/**
+ * @brief Function which generates the next instruction.
+ *
+ * @param record  Pointer to the record to populate.
+ */
+void
+TraceGenerator::next(
+  trace_record_t* const record
+)
+{
+  if ((m_params.phase_length > 0) && (m_count > 0) && ((m_count % m_params.phase_length) == 0)) {
+    startPhase();
+  }
+
+  record->instruction_address = static_cast<uint32_t>(0x400000 + 4 * m_count);
+  double op = uniform();
+  record->op_code = TRACE_GEN_OP_CODES - 2;
+  for (uint32_t o = 0; o < TRACE_GEN_OP_CODES; ++o) {
+    if (op < m_opThreshold[o]) {
+      record->op_code = static_cast<int32_t>(o) - 1;
+      break;
+    }
+  }
+
+  // geometric distances with the mean of the phase, by inverting the distribution
+  double p = 1.0 / std::max(m_meanDistance, 1.0);
+  for (int s = 0; s < 2; ++s) {
+    if (uniform() < m_params.no_src) {
+      record->src_reg[s] = -1;
+      continue;
+    }
+    uint64_t distance = 1;
+    if (p < 1.0) {
+      distance += static_cast<uint64_t>(std::log(1.0 - uniform()) / std::log(1.0 - p));
+    }
+    distance = std::min(distance, static_cast<uint64_t>(m_params.max_distance));
+    int32_t reg = (distance <= m_count) ? m_recentDest[(m_count - distance) % m_params.max_distance] : -1;
+    // read any register if the producer did not write one
+    record->src_reg[s] = (reg >= 0) ? reg : static_cast<int32_t>(random() % m_params.registers);
+  }
+
+  record->dest_reg = (uniform() < m_params.no_dest) ? -1 : static_cast<int32_t>(random() % m_params.registers);
+  m_recentDest[m_count % m_params.max_distance] = record->dest_reg;
+  ++m_count;
+}
@@ -0,0 +1,66 @@
+#ifndef TRACE_GEN_HPP
+#define TRACE_GEN_HPP
+
+#include "trace.hpp"
+
+#include <vector>
+
+#define TRACE_GEN_OP_CODES 4
+
+/**
+ * @brief Struct for storing the parameters of a synthetic trace
+ */
+typedef struct _trace_gen_params_t {
+  uint64_t seed;
+  // relative weights of the op codes -1, 0, 1 and 2
+  double op_mix[TRACE_GEN_OP_CODES];
+  // sources read the destination of an instruction a geometrically distributed
+  // distance back, with this mean, up to the maximum distance
+  double mean_distance;
+  uint32_t max_distance;
+  // number of registers used as destinations, fewer registers means more reuse
+  uint32_t registers;
+  // fraction of instructions without a destination register
+  double no_dest;
+  // fraction of source operands which are not used
+  double no_src;
+  // instructions in a phase, 0 for a single phase; every phase rotates the
+  // op mix of the FU types and alternates the mean distance with a scaled one
+  uint64_t phase_length;
+  double phase_distance_scale;
+} trace_gen_params_t;
+
+/**
+ * @brief Generator of reproducible synthetic traces, one instruction at a time,
+ *        so traces of any length can be written with constant memory.
+ */
+class TraceGenerator {
+public:
+  TraceGenerator(const trace_gen_params_t&);
+
+  void next(trace_record_t* const);
+
+  static trace_gen_params_t defaultParams();
+
+private:
+  uint64_t random();
+
+  double uniform() { return (random() >> 11) * (1.0 / 9007199254740992.0); }
+
+  void startPhase();
+
+private:
+  trace_gen_params_t m_params;
+
+  // cumulative op mix and mean distance of the current phase
+  double m_opThreshold[TRACE_GEN_OP_CODES];
+  double m_meanDistance;
+
+  // destination registers of the most recent instructions, indexed by instruction number
+  std::vector<int32_t> m_recentDest;
+
+  uint64_t m_state;
+  uint64_t m_count;
+};
+
+#endif /* TRACE_GEN_HPP */
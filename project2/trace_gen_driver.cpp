@@ -0,0 +1,111 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "trace_gen.hpp"
+
+#define DEFAULT_COUNT 1000000
+#define OUTPUT_BUFFER (1 << 20)
+
+void print_help_and_exit(void) {
+    trace_gen_params_t params = TraceGenerator::defaultParams();
+    printf("trace_gen [OPTIONS]\n");
+    printf("  -o traces/file.trace\tTrace to write (default: stdout)\n");
+    printf("  -b\t\t\tWrite a binary trace instead of a text trace\n");
+    printf("  -n N\t\t\tNumber of instructions (default: %d)\n", DEFAULT_COUNT);
+    printf("  -s N\t\t\tRandom seed (default: %" PRIu64 ")\n", params.seed);
+    printf("  -m W,W0,W1,W2\t\tRelative weights of op codes -1, 0, 1 and 2 (default: 1,1,1,1)\n");
+    printf("  -d D\t\t\tMean dependency distance (default: %.0f)\n", params.mean_distance);
+    printf("  -D N\t\t\tMaximum dependency distance (default: %" PRIu32 ")\n", params.max_distance);
+    printf("  -r N\t\t\tNumber of destination registers, at most 128 (default: %" PRIu32 ")\n", params.registers);
+    printf("  -z F\t\t\tFraction of instructions without a destination (default: %.3f)\n", params.no_dest);
+    printf("  -u F\t\t\tFraction of unused source operands (default: %.3f)\n", params.no_src);
+    printf("  -p N\t\t\tInstructions in a phase, 0 for a single phase (default: 0)\n");
+    printf("  -P X\t\t\tScale of the mean dependency distance in every other phase (default: %.0f)\n", params.phase_distance_scale);
+    printf("  -h\t\t\tThis helpful output\n");
+    exit(0);
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    const char* outName = NULL;
+    bool binary = false;
+    uint64_t count = DEFAULT_COUNT;
+    trace_gen_params_t params = TraceGenerator::defaultParams();
+
+    while(-1 != (opt = getopt(argc, argv, "o:bn:s:m:d:D:r:z:u:p:P:h"))) {
+        switch(opt) {
+        case 'o':
+            outName = optarg;
+            break;
+        case 'b':
+            binary = true;
+            break;
+        case 'n':
+            count = strtoull(optarg, NULL, 10);
+            break;
+        case 's':
+            params.seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'm':
+            if (sscanf(optarg, "%lf,%lf,%lf,%lf", &params.op_mix[0], &params.op_mix[1], &params.op_mix[2], &params.op_mix[3]) != 4) {
+                fprintf(stderr, "-m needs a weight for every op code, like 0,1,1,1\n");
+                print_help_and_exit();
+            }
+            break;
+        case 'd':
+            params.mean_distance = atof(optarg);
+            break;
+        case 'D':
+            params.max_distance = atoi(optarg);
+            break;
+        case 'r':
+            params.registers = atoi(optarg);
+            break;
+        case 'z':
+            params.no_dest = atof(optarg);
+            break;
+        case 'u':
+            params.no_src = atof(optarg);
+            break;
+        case 'p':
+            params.phase_length = strtoull(optarg, NULL, 10);
+            break;
+        case 'P':
+            params.phase_distance_scale = atof(optarg);
+            break;
+        case 'h':
+            /* Fall through */
+        default:
+            print_help_and_exit();
+            break;
+        }
+    }
+
+    FILE* outFile = stdout;
+    if (outName != NULL && (outFile = fopen(outName, binary ? "wb" : "w")) == NULL)
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", outName);
+        return 1;
+    }
+    setvbuf(outFile, NULL, _IOFBF, OUTPUT_BUFFER);
+
+    bool written = !binary || write_trace_header(outFile, count);
+    TraceGenerator generator(params);
+    trace_record_t record;
+    for (uint64_t i = 0; written && (i < count); ++i) {
+        generator.next(&record);
+        if (binary) {
+            written = (fwrite(&record, sizeof(trace_record_t), 1, outFile) == 1);
+        }
+        else {
+            written = (fprintf(outFile, "%x %d %d %d %d\n", record.instruction_address, record.op_code,
+                               record.dest_reg, record.src_reg[0], record.src_reg[1]) > 0);
+        }
+    }
+    if (!written || (fclose(outFile) != 0)) {
+        fprintf(stderr, "Failed to write %s\n", (outName != NULL) ? outName : "the trace");
+        return 1;
+    }
+    return 0;
+}